@@ -0,0 +1,184 @@
+#include <stdint.h> // int16_t, int64_t
+
+// Exact cover formulation of sudoku solved with Algorithm X / Dancing Links.
+//
+// The links are kept as parallel `int16_t` arrays indexed by node number
+// instead of pointers, so the whole matrix for one puzzle fits in ~40KB and
+// stays in L1/L2 while searching. Node 0 is the root, nodes 1..324 are the
+// column headers and everything after that are the 4 nodes of each candidate.
+
+#define DLX_CELL_COLUMNS 81
+#define DLX_COLUMNS (4 * DLX_CELL_COLUMNS)
+#define DLX_MAX_ROWS (81 * 9)
+#define DLX_MAX_NODES (1 + DLX_COLUMNS + 4 * DLX_MAX_ROWS)
+
+#define DLX_NO_SOLUTION 0
+#define DLX_SOLVED 1
+#define DLX_EXHAUSTED -1
+
+typedef struct Dlx {
+    int16_t left[DLX_MAX_NODES];
+    int16_t right[DLX_MAX_NODES];
+    int16_t up[DLX_MAX_NODES];
+    int16_t down[DLX_MAX_NODES];
+    int16_t column[DLX_MAX_NODES];
+    int16_t row[DLX_MAX_NODES]; // cell * 9 + val
+    int16_t size[1 + DLX_COLUMNS];
+    int16_t node_count;
+} Dlx;
+
+void dlx_init(Dlx* dlx) {
+    for (int16_t col = 0; col <= DLX_COLUMNS; ++col) {
+        dlx->left[col] = (col == 0) ? DLX_COLUMNS : col - 1;
+        dlx->right[col] = (col == DLX_COLUMNS) ? 0 : col + 1;
+        dlx->up[col] = col;
+        dlx->down[col] = col;
+        dlx->column[col] = col;
+        dlx->size[col] = 0;
+    }
+    dlx->node_count = 1 + DLX_COLUMNS;
+}
+
+void dlx_add_row(Dlx* dlx, int cell, int val) {
+    int row = cell / 9;
+    int col = cell % 9;
+    int box = (row / 3) * 3 + col / 3;
+
+    int16_t columns[4] = {
+        1 + cell,
+        1 + 81 + row * 9 + val,
+        1 + 162 + col * 9 + val,
+        1 + 243 + box * 9 + val,
+    };
+
+    int16_t first = dlx->node_count;
+    for (int idx = 0; idx < 4; ++idx) {
+        int16_t node = first + idx;
+        int16_t header = columns[idx];
+
+        dlx->left[node] = (idx == 0) ? first + 3 : node - 1;
+        dlx->right[node] = (idx == 3) ? first : node + 1;
+
+        dlx->up[node] = dlx->up[header];
+        dlx->down[node] = header;
+        dlx->down[dlx->up[header]] = node;
+        dlx->up[header] = node;
+
+        dlx->column[node] = header;
+        dlx->row[node] = cell * 9 + val;
+        dlx->size[header] += 1;
+    }
+    dlx->node_count += 4;
+}
+
+void dlx_cover(Dlx* dlx, int16_t col) {
+    dlx->right[dlx->left[col]] = dlx->right[col];
+    dlx->left[dlx->right[col]] = dlx->left[col];
+
+    for (int16_t i = dlx->down[col]; i != col; i = dlx->down[i]) {
+        for (int16_t j = dlx->right[i]; j != i; j = dlx->right[j]) {
+            dlx->down[dlx->up[j]] = dlx->down[j];
+            dlx->up[dlx->down[j]] = dlx->up[j];
+            dlx->size[dlx->column[j]] -= 1;
+        }
+    }
+}
+
+void dlx_uncover(Dlx* dlx, int16_t col) {
+    for (int16_t i = dlx->up[col]; i != col; i = dlx->up[i]) {
+        for (int16_t j = dlx->left[i]; j != i; j = dlx->left[j]) {
+            dlx->size[dlx->column[j]] += 1;
+            dlx->down[dlx->up[j]] = j;
+            dlx->up[dlx->down[j]] = j;
+        }
+    }
+
+    dlx->right[dlx->left[col]] = col;
+    dlx->left[dlx->right[col]] = col;
+}
+
+// Column with the fewest remaining rows. Stops early on 0 or 1 since nothing
+// can beat those.
+int16_t dlx_choose_column(Dlx* dlx) {
+    int16_t best = dlx->right[0];
+    int16_t min = dlx->size[best];
+    for (int16_t col = dlx->right[best]; (min > 1) & (col != 0); col = dlx->right[col]) {
+        best = (dlx->size[col] < min) ? col : best;
+        min = (dlx->size[col] < min) ? dlx->size[col] : min;
+    }
+    return best;
+}
+
+// `candidates` holds one 9 bit mask per cell (bit `val` set if `val` is still
+// possible), `solution` receives one single bit mask per cell.
+//
+// `node_budget` bounds the number of rows tried; the count used is written to
+// `nodes`. Returns DLX_SOLVED, DLX_NO_SOLUTION or DLX_EXHAUSTED.
+int dlx_solve(const uint16_t* candidates, uint16_t* solution, int64_t node_budget, int64_t* nodes) {
+    Dlx dlx;
+    dlx_init(&dlx);
+
+    for (int cell = 0; cell < 81; ++cell) {
+        for (int val = 0; val < 9; ++val) {
+            if ((candidates[cell] >> val) & 1) {
+                dlx_add_row(&dlx, cell, val);
+            }
+        }
+    }
+
+    int16_t chosen[81];
+    int depth = 0;
+    int descend = 1;
+    int16_t node = 0;
+    *nodes = 0;
+
+    while (1) {
+        if (descend) {
+            if (dlx.right[0] == 0) {
+                for (int idx = 0; idx < depth; ++idx) {
+                    int16_t row = dlx.row[chosen[idx]];
+                    solution[row / 9] = 1u << (row % 9);
+                }
+                return DLX_SOLVED;
+            }
+
+            int16_t col = dlx_choose_column(&dlx);
+            if (dlx.size[col] == 0) {
+                descend = 0;
+                continue;
+            }
+            dlx_cover(&dlx, col);
+            node = dlx.down[col];
+        } else {
+            if (depth == 0) {
+                return DLX_NO_SOLUTION;
+            }
+            depth -= 1;
+            node = chosen[depth];
+            for (int16_t j = dlx.left[node]; j != node; j = dlx.left[j]) {
+                dlx_uncover(&dlx, dlx.column[j]);
+            }
+            node = dlx.down[node];
+        }
+
+        int16_t col = dlx.column[node];
+        if (node == col) {
+            // Every row of this column has been tried
+            dlx_uncover(&dlx, col);
+            descend = 0;
+            continue;
+        }
+
+        if (*nodes >= node_budget) {
+            return DLX_EXHAUSTED;
+        }
+        *nodes += 1;
+
+        chosen[depth] = node;
+        depth += 1;
+        for (int16_t j = dlx.right[node]; j != node; j = dlx.right[j]) {
+            dlx_cover(&dlx, dlx.column[j]);
+        }
+        descend = 1;
+    }
+}
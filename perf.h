@@ -0,0 +1,185 @@
+#include <errno.h> // errno
+#include <stdint.h> // uint64_t
+#include <stdio.h> // fprintf
+#include <string.h> // memset, strerror
+#include <unistd.h> // syscall, read, close
+
+#include <linux/perf_event.h> // perf_event_attr, PERF_*
+#include <sys/ioctl.h> // ioctl
+#include <sys/syscall.h> // SYS_perf_event_open
+
+// Hardware counters read around a region of code with perf_event_open. All
+// counters are opened as one group so they are scheduled on the PMU together
+// and read with a single syscall. Counters the kernel (or the CPU) refuses are
+// left out; if none can be opened every read returns zeros and `available`
+// stays 0, so callers can keep running without counters. Each sample also
+// carries how long the group was enabled and how long it actually ran on the
+// PMU, so samples that were multiplexed (or never scheduled) can be flagged.
+
+#define PERF_COUNTER_COUNT 5
+
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_BRANCH_MISSES 2
+#define PERF_L1D_MISSES 3
+#define PERF_UOPS 4
+
+const char* PERF_COUNTER_NAMES[PERF_COUNTER_COUNT] = {
+    "cycles", "instructions", "branch-misses", "l1d-misses", "uops"
+};
+
+typedef struct PerfCounters {
+    int fds[PERF_COUNTER_COUNT]; // -1 when the counter could not be opened
+    int leader;
+    int available;
+} PerfCounters;
+
+typedef struct PerfSample {
+    uint64_t values[PERF_COUNTER_COUNT];
+    uint64_t enabled; // ns the group was enabled
+    uint64_t running; // ns it was counting, less than `enabled` if multiplexed
+} PerfSample;
+
+void perf_event_attr_for(struct perf_event_attr* attr, int counter) {
+    memset(attr, 0, sizeof(*attr));
+    attr->size = sizeof(*attr);
+    attr->disabled = 1;
+    attr->exclude_kernel = 1; // Allowed with perf_event_paranoid <= 2
+    attr->exclude_hv = 1;
+    attr->read_format = PERF_FORMAT_GROUP
+                      | PERF_FORMAT_TOTAL_TIME_ENABLED
+                      | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter) {
+        case PERF_CYCLES:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_INSTRUCTIONS:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_BRANCH_MISSES:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case PERF_L1D_MISSES:
+            attr->type = PERF_TYPE_HW_CACHE;
+            attr->config = PERF_COUNT_HW_CACHE_L1D
+                         | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                         | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_UOPS:
+            // UOPS_ISSUED.ANY (event 0x0E, umask 0x01) on Skylake, which is
+            // what compile_flags.txt targets.
+            attr->type = PERF_TYPE_RAW;
+            attr->config = 0x010E;
+            break;
+    }
+}
+
+PerfCounters perf_open() {
+    PerfCounters counters;
+    counters.leader = -1;
+    counters.available = 0;
+
+    int first_errno = 0;
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        struct perf_event_attr attr;
+        perf_event_attr_for(&attr, counter);
+
+        int fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, counters.leader, 0);
+        if (fd < 0 && first_errno == 0) {
+            first_errno = errno;
+        }
+        counters.fds[counter] = fd;
+        if (fd >= 0 && counters.leader < 0) {
+            counters.leader = fd;
+        }
+        counters.available += (fd >= 0);
+    }
+
+    if (counters.leader < 0) {
+        fprintf(stderr, "perf counters unavailable: %s "
+                        "(see /proc/sys/kernel/perf_event_paranoid)\n",
+                strerror(first_errno));
+        return counters;
+    }
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        if (counters.fds[counter] < 0) {
+            fprintf(stderr, "perf counter %s unavailable, printing -\n",
+                    PERF_COUNTER_NAMES[counter]);
+        }
+    }
+
+    ioctl(counters.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counters.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return counters;
+}
+
+void perf_close(PerfCounters* counters) {
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        if (counters->fds[counter] >= 0) {
+            close(counters->fds[counter]);
+        }
+    }
+    counters->leader = -1;
+    counters->available = 0;
+}
+
+// Current running totals. Subtract two samples to count a region.
+PerfSample perf_read(PerfCounters* counters) {
+    PerfSample sample;
+    memset(&sample, 0, sizeof(sample));
+    if (counters->leader < 0) {
+        return sample;
+    }
+
+    // { nr, time_enabled, time_running, values[nr] } with the values in the
+    // order the fds were opened
+    uint64_t buffer[3 + PERF_COUNTER_COUNT];
+    if (read(counters->leader, buffer, sizeof(buffer)) < (ssize_t) (3 * sizeof(uint64_t))) {
+        return sample;
+    }
+    sample.enabled = buffer[1];
+    sample.running = buffer[2];
+
+    uint64_t value_idx = 3;
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        if (counters->fds[counter] >= 0 && value_idx < 3 + buffer[0]) {
+            sample.values[counter] = buffer[value_idx];
+            ++value_idx;
+        }
+    }
+    return sample;
+}
+
+PerfSample perf_delta(PerfSample end, PerfSample start) {
+    PerfSample delta;
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        delta.values[counter] = end.values[counter] - start.values[counter];
+    }
+    delta.enabled = end.enabled - start.enabled;
+    delta.running = end.running - start.running;
+    return delta;
+}
+
+void perf_accumulate(PerfSample* total, PerfSample sample) {
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        total->values[counter] += sample.values[counter];
+    }
+    total->enabled += sample.enabled;
+    total->running += sample.running;
+}
+
+// Whether the group was descheduled for part of `sample`, so its counts are
+// short (or all zero if it never ran).
+int perf_is_partial(PerfSample sample) {
+    return sample.running < sample.enabled;
+}
+
+double perf_ipc(PerfSample sample) {
+    return sample.values[PERF_CYCLES]
+         ? (double) sample.values[PERF_INSTRUCTIONS] / (double) sample.values[PERF_CYCLES]
+         : 0.0;
+}
@@ -0,0 +1,148 @@
+// CPython extension exposing the batch solver.
+//
+// Arrays are exchanged through the buffer protocol, so NumPy arrays (or any
+// other C contiguous buffer) are read and written in place. NumPy is only
+// imported to allocate the outputs when the caller does not pass them.
+//
+// Build with `python setup.py build_ext --inplace`.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#define SOLVER_NO_MAIN
+#include "solver.c"
+
+// Whether the struct format of `view` is one of the characters in `codes`, in
+// native byte order. A NULL format means unsigned bytes.
+static int has_format(Py_buffer* view, const char* codes) {
+    const char* format = (view->format != NULL) ? view->format : "B";
+    if ((format[0] == '@') || (format[0] == '=') || (format[0] == '<')) {
+        ++format;
+    }
+    return (format[0] != '\0') && (format[1] == '\0') && (strchr(codes, format[0]) != NULL);
+}
+
+// Number of `row_length` item rows in `view`, or -1 with an exception set.
+// `codes` are the accepted struct format characters for items of `itemsize`.
+static Py_ssize_t grid_rows(Py_buffer* view, const char* name, const char* codes,
+                            Py_ssize_t itemsize, Py_ssize_t row_length) {
+    if (view->itemsize != itemsize || !has_format(view, codes)) {
+        PyErr_Format(PyExc_TypeError, "%s: expected %zd byte integers, got format '%s'",
+                     name, itemsize, (view->format != NULL) ? view->format : "B");
+        return -1;
+    }
+    if (view->ndim == 2 && view->shape[1] == row_length) {
+        return view->shape[0];
+    }
+    if (view->ndim == 1 && view->shape[0] % row_length == 0) {
+        return view->shape[0] / row_length;
+    }
+    PyErr_Format(PyExc_ValueError, "%s: expected shape (N, %zd)", name, row_length);
+    return -1;
+}
+
+static PyObject* alloc_array(Py_ssize_t rows, Py_ssize_t cols, const char* dtype) {
+    PyObject* numpy = PyImport_ImportModule("numpy");
+    if (numpy == NULL) { return NULL; }
+
+    PyObject* array = PyObject_CallMethod(numpy, "empty", "(nn)s", rows, cols, dtype);
+    Py_DECREF(numpy);
+    return array;
+}
+
+static PyObject* py_solve_batch(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static char* keywords[] = {"puzzles", "out", "stats", "threads", NULL};
+    PyObject* puzzles_obj = NULL;
+    PyObject* out_obj = Py_None;
+    PyObject* stats_obj = Py_None;
+    int threads = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OOi", keywords,
+                                     &puzzles_obj, &out_obj, &stats_obj, &threads)) {
+        return NULL;
+    }
+
+    Py_buffer puzzles = {0};
+    Py_buffer out = {0};
+    Py_buffer stats = {0};
+    PyObject* out_array = NULL;
+    PyObject* stats_array = NULL;
+    PyObject* result = NULL;
+
+    if (PyObject_GetBuffer(puzzles_obj, &puzzles, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+        return NULL;
+    }
+    Py_ssize_t count = grid_rows(&puzzles, "puzzles", "B", 1, 81);
+    if (count < 0) { goto done; }
+
+    const uint8_t* digits = puzzles.buf;
+    for (Py_ssize_t idx = 0; idx < count * 81; ++idx) {
+        if (digits[idx] > 9) {
+            PyErr_Format(PyExc_ValueError, "puzzles: digit %d at row %zd, cell %zd is not 0..9",
+                         (int) digits[idx], idx / 81, idx % 81);
+            goto done;
+        }
+    }
+
+    if (out_obj == Py_None) {
+        out_array = alloc_array(count, 81, "uint8");
+    } else {
+        out_array = out_obj;
+        Py_INCREF(out_array);
+    }
+    if (stats_obj == Py_None) {
+        stats_array = alloc_array(count, 2, "int64");
+    } else {
+        stats_array = stats_obj;
+        Py_INCREF(stats_array);
+    }
+    if (out_array == NULL || stats_array == NULL) { goto done; }
+
+    int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | PyBUF_WRITABLE;
+    if (PyObject_GetBuffer(out_array, &out, flags) < 0) { goto done; }
+    if (PyObject_GetBuffer(stats_array, &stats, flags) < 0) { goto done; }
+    if (grid_rows(&out, "out", "B", 1, 81) != count
+            || grid_rows(&stats, "stats", "ql", 8, 2) != count) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_ValueError, "out and stats must have one row per puzzle");
+        }
+        goto done;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    solve_batch(puzzles.buf, out.buf, stats.buf, (size_t) count, threads);
+    Py_END_ALLOW_THREADS
+
+    result = PyTuple_Pack(2, out_array, stats_array);
+
+done:
+    if (stats.obj != NULL) { PyBuffer_Release(&stats); }
+    if (out.obj != NULL) { PyBuffer_Release(&out); }
+    PyBuffer_Release(&puzzles);
+    Py_XDECREF(out_array);
+    Py_XDECREF(stats_array);
+    return result;
+}
+
+static PyMethodDef methods[] = {
+    {
+        "solve_batch", (PyCFunction) py_solve_batch, METH_VARARGS | METH_KEYWORDS,
+        "solve_batch(puzzles, out=None, stats=None, threads=0) -> (out, stats)\n\n"
+        "Solves an (N, 81) uint8 array of digits (0 for an empty cell) without\n"
+        "holding the GIL. `out` receives the (N, 81) uint8 solutions (all 0 when\n"
+        "unsolved) and `stats` the (N, 2) int64 pairs (is_solved, nodes). Both\n"
+        "are allocated with NumPy when not given. `threads <= 0` uses one thread\n"
+        "per online CPU. `nodes` counts DFS branches plus, for puzzles handed\n"
+        "over to Dancing Links, the rows it tried. Raises TypeError for other\n"
+        "dtypes and ValueError for digits above 9."
+    },
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef module = {
+    PyModuleDef_HEAD_INIT, "sudoku_solver", NULL, -1, methods
+};
+
+PyMODINIT_FUNC PyInit_sudoku_solver(void) {
+    return PyModule_Create(&module);
+}
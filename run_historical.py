@@ -2,6 +2,7 @@
 import argparse
 from contextlib import contextmanager
 from functools import partial
+from glob import glob
 from itertools import dropwhile
 import os
 from subprocess import run, PIPE
@@ -75,16 +76,16 @@ def clone_to_tmpdir(first_commit, **flag_kwargs):
 
             with tempfile.TemporaryDirectory(suffix="-" + commit) as output_td:
                 solver_exec = os.path.join(output_td, "solver")
-                bitset_exec = os.path.join(output_td, "test_bitset")
 
                 compile("solver.c", solver_exec, flags=flags)
                 solver_with_args = [solver_exec, *DATA_FILES]
                 with time_it(commit):
                     run(solver_with_args, check=True)
 
-                if os.path.exists("test_bitset.c"):
-                    compile("test_bitset.c", bitset_exec, flags=flags)
-                    run([bitset_exec], check=True)
+                for test_file in sorted(glob("test_*.c")):
+                    test_exec = os.path.join(output_td, test_file[:-len(".c")])
+                    compile(test_file, test_exec, flags=flags)
+                    run([test_exec], check=True)
 
                 if perf_dir is not None and os.path.exists(perf_dir):
                     output_flag = f'--output={perf_dir}/{commit}.data'
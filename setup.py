@@ -0,0 +1,24 @@
+#!/usr/bin/env python
+import os
+
+from setuptools import Extension, setup
+
+REPO_PATH = os.path.dirname(os.path.abspath(__file__))
+
+def get_compile_flags():
+    with open(os.path.join(REPO_PATH, "compile_flags.txt")) as f:
+        return ["-O2", *map(lambda s: s.strip(), f.readlines())]
+
+setup(
+    name="sudoku_solver",
+    ext_modules=[
+        Extension(
+            "sudoku_solver",
+            sources=["pysolver.c"],
+            depends=["solver.c", "bitset.h", "simd.h", "dlx.h", "tables.c", "perf.h",
+                     "validate.h", "store.h"],
+            extra_compile_args=get_compile_flags(),
+            extra_link_args=["-pthread"],
+        )
+    ],
+)
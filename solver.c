@@ -1,5 +1,11 @@
-#include <unistd.h> // read
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE // sysconf(_SC_NPROCESSORS_ONLN), syscall, qsort_r
+#endif
+
+#include <unistd.h> // read, sysconf
+#include <pthread.h> // pthread_create, pthread_join
 #include <sys/stat.h> // fstat
+#include <sys/mman.h> // mmap, madvise
 #include <fcntl.h> // open, close
 
 #include <stddef.h> // size_t
@@ -7,12 +13,17 @@
 #include <stdio.h> // printf
 #include <stdlib.h> // calloc
 #include <string.h> // strcmp
+#include <time.h> // clock_gettime
 
 #include <x86intrin.h> // tzcnt, popcnt
 
 #include "bitset.h"
 #include "tables.c"
 #include "simd.h"
+#include "dlx.h"
+#include "perf.h"
+#include "validate.h"
+#include "store.h"
 
 #ifndef DEBUG_VERIFY
     #define DEBUG_VERIFY 0
@@ -31,8 +42,43 @@ typedef struct Board {
 typedef struct Solution {
     Board solution;
     int is_solved;
+    int is_exhausted; // Gave up after `node_budget` branches
+    // Search effort: DFS branches or DLX rows tried. In auto mode this is the
+    // DFS branches spent before handing over plus the DLX rows, which are not
+    // the same unit, so compare it only between runs of the same engine.
+    int64_t nodes;
 } Solution;
 
+typedef enum Engine {
+    ENGINE_AUTO,
+    ENGINE_DFS,
+    ENGINE_DLX,
+} Engine;
+
+const int64_t NO_NODE_BUDGET = INT64_MAX;
+
+typedef struct Options {
+    Engine engine;
+    int perf_counters; // Print hardware counters per puzzle and per file
+    int validate; // Check completed grids instead of solving
+    Store* store; // Solutions shared across runs, NULL if not used
+    int shard_index; // Only solve this slice of each input, 0-based
+    int shard_count; // 0 when not sharding
+    const char* output; // Shard result file, defaults to <input>.shard-<i>-of-<N>
+    int session_bench; // Time single given edits through a `Session` instead of solving
+} Options;
+
+// Entries of a store created by `--store` unless `--store-cap` is given
+const uint64_t DEFAULT_STORE_CAP = 1ul << 20;
+
+typedef struct ShardStats {
+    int64_t puzzles;
+    int64_t solved;
+    int64_t nodes; // Of the puzzles that were searched
+    int64_t ns;
+    int64_t stored; // Puzzles answered from `--store`, with 0 nodes
+} ShardStats;
+
 typedef struct State {
     Board current;
     int8_t idxs[81];
@@ -324,18 +370,22 @@ void print_board(Board board) {
     }
 }
 
-void print_solution(Solution solution) {
+void fprint_solution(FILE* file, Solution solution) {
     const char* digits = "123456789";
     if (solution.is_solved) {
         for (int idx = 0; idx < 81; ++idx) {
             int val = __tzcnt_u32(solution.solution.flags[idx]);
             if (val >= 9 || __builtin_popcount(solution.solution.flags[idx]) != 1) { exit(2); }
-            printf("%c", digits[val]);
+            fputc(digits[val], file);
         }
     } else {
-        printf("Unsolved!");
+        fprintf(file, "Unsolved!");
     }
-    printf("\n");
+    fputc('\n', file);
+}
+
+void print_solution(Solution solution) {
+    fprint_solution(stdout, solution);
 }
 
 void print_flags(const Board* board) {
@@ -353,8 +403,8 @@ void print_flags(const Board* board) {
     printf("\n");
 }
 
-Solution solve_from_candidates(Stack* stack_ptr) {
-    Solution solution = (Solution) {make_empty_board(), 0};
+Solution solve_from_candidates(Stack* stack_ptr, int64_t node_budget) {
+    Solution solution = (Solution) {make_empty_board(), 0, 0, 0};
 
     while(stack_nonempty(stack_ptr)) {
         State state = stack_pop(stack_ptr);
@@ -393,6 +443,12 @@ Solution solve_from_candidates(Stack* stack_ptr) {
                 }
             } else {
                 //printf("Adding new branch!\n");
+                if (solution.nodes >= node_budget) {
+                    solution.is_exhausted = 1;
+                    return solution;
+                }
+                solution.nodes += 1;
+
                 State next = state;
                 int val = __tzcnt_u32(state.current.flags[idx]);
 
@@ -415,7 +471,60 @@ Solution solve_from_candidates(Stack* stack_ptr) {
     return solution;
 }
 
-Solution solve_one(const char* problem) {
+Solution solve_dfs(State state, int64_t node_budget) {
+    Stack stack = alloc_stack(81ul);
+    stack_push(&stack, state);
+
+    Solution solution = solve_from_candidates(&stack, node_budget);
+    free(stack.data);
+
+    return solution;
+}
+
+Solution solve_dlx(State state, int64_t node_budget) {
+    Solution solution = (Solution) {state.current, 0, 0, 0};
+
+    if (!verify_m256(&state.current)) {
+        return solution;
+    }
+
+    int result = dlx_solve(
+        state.current.flags, solution.solution.flags, node_budget, &solution.nodes
+    );
+    solution.is_solved = (result == DLX_SOLVED);
+    solution.is_exhausted = (result == DLX_EXHAUSTED);
+
+    return solution;
+}
+
+// Auto mode races the engines: DFS has almost no setup cost and finishes most
+// puzzles within a few dozen branches, DLX builds a ~3000 node matrix first but
+// prunes far better on the hard ones. Candidate counts after propagation did
+// not separate the two on either hardest1106 or on easier puzzles derived
+// from it, so DFS always goes first and DLX takes over after this many
+// branches.
+const int64_t AUTO_NODE_BUDGET = 50;
+
+Solution solve_with_engine(State state, Engine engine) {
+    if (engine == ENGINE_DFS) {
+        return solve_dfs(state, NO_NODE_BUDGET);
+    } else if (engine == ENGINE_DLX) {
+        return solve_dlx(state, NO_NODE_BUDGET);
+    }
+
+    Solution solution = solve_dfs(state, AUTO_NODE_BUDGET);
+    if (!solution.is_exhausted) {
+        return solution;
+    }
+
+    // Branches and rows are summed, see `Solution.nodes`
+    int64_t spent = solution.nodes;
+    solution = solve_dlx(state, NO_NODE_BUDGET);
+    solution.nodes += spent;
+    return solution;
+}
+
+State make_problem_state(const char* problem) {
     State state = make_empty_state();
 
     for (int idx = 0; idx < 81; ++idx) {
@@ -426,57 +535,443 @@ Solution solve_one(const char* problem) {
         }
     }
 
-    Stack stack = alloc_stack(81ul);
-    stack_push(&stack, state);
+    return state;
+}
 
-    Solution solution = solve_from_candidates(&stack);
-    free(stack.data);
+Solution solve_one_with(const char* problem, Engine engine) {
+    return solve_with_engine(make_problem_state(problem), engine);
+}
+
+Solution solve_one(const char* problem) {
+    return solve_one_with(problem, ENGINE_AUTO);
+}
+
+// 81 digits of a solved board.
+void solution_to_chars(Solution solution, char* output) {
+    for (int idx = 0; idx < 81; ++idx) {
+        output[idx] = '1' + __tzcnt_u32(solution.solution.flags[idx]);
+    }
+}
+
+void store_solution(Store* store, const char* problem, Engine engine, Solution solution) {
+    char chars[81];
+    if (solution.is_solved) {
+        solution_to_chars(solution, chars);
+    }
+    uint32_t nodes = (solution.nodes < UINT32_MAX) ? (uint32_t) solution.nodes : UINT32_MAX;
+    store_insert(store, problem, (uint32_t) engine, solution.is_solved ? chars : NULL, nodes);
+}
+
+// `solve_one_with`, answered from `store` when the puzzle was solved before
+// with the same engine. Answers from the store report 0 nodes, since no
+// search ran.
+Solution solve_one_stored(const char* problem, Engine engine, Store* store, int* is_hit) {
+    char chars[81];
+    int is_solved = 0;
+    uint32_t nodes = 0;
+
+    *is_hit = store_lookup(store, problem, (uint32_t) engine, chars, &is_solved, &nodes);
+    if (*is_hit) {
+        Solution solution = (Solution) {make_empty_board(), is_solved, 0, 0};
+        if (is_solved) {
+            solution.solution = make_solution_board(chars);
+        }
+        return solution;
+    }
 
+    Solution solution = solve_one_with(problem, engine);
+    store_solution(store, problem, engine, solution);
     return solution;
 }
 
-void solve_from_csv(const char* filename, int has_solution) {
+// A puzzle being edited one given at a time. Keeps the board after each
+// propagated given, so adding a given costs one `mark_true` and removing one
+// replays only the givens added after it. The cached solution is searched for
+// again only when an edit can invalidate it: a new given that disagrees with
+// it, or a removal while the puzzle was unsolvable.
+typedef struct Session {
+    Board checkpoints[82]; // checkpoints[k] has order[0..k) propagated
+    int8_t order[81]; // Given cells in the order they were propagated
+    char givens[81]; // '0' for empty cells
+    int given_count;
+    Engine engine;
+    Solution solution;
+    int searched; // Last edit had to search
+} Session;
+
+void session_search(Session* session) {
+    State state = make_empty_state();
+    state.current = session->checkpoints[session->given_count];
+    session->solution = solve_with_engine(state, session->engine);
+    session->searched = 1;
+}
+
+void session_propagate(Session* session, int cell) {
+    int count = session->given_count;
+    session->checkpoints[count + 1] = session->checkpoints[count];
+    mark_true(&session->checkpoints[count + 1], cell, val_to_mask(session->givens[cell] - '1'));
+    session->order[count] = cell;
+    session->given_count = count + 1;
+}
+
+void session_start(Session* session, const char* problem, Engine engine) {
+    session->checkpoints[0] = make_empty_board();
+    session->given_count = 0;
+    session->engine = engine;
+
+    for (int cell = 0; cell < 81; ++cell) {
+        int is_given = (problem[cell] != '0') && (problem[cell] != '.');
+        session->givens[cell] = is_given ? problem[cell] : '0';
+        if (is_given) {
+            session_propagate(session, cell);
+        }
+    }
+    session_search(session);
+}
+
+Solution session_remove(Session* session, int cell) {
+    session->searched = 0;
+    if (session->givens[cell] == '0') {
+        return session->solution;
+    }
+
+    int position = 0;
+    while (session->order[position] != cell) {
+        ++position;
+    }
+    session->givens[cell] = '0';
+
+    // Replay the givens propagated after `cell` on top of its checkpoint
+    int count = session->given_count;
+    session->given_count = position;
+    for (int idx = position + 1; idx < count; ++idx) {
+        session_propagate(session, session->order[idx]);
+    }
+
+    // A solution stays one with fewer givens, only an unsolvable puzzle can change
+    if (!session->solution.is_solved) {
+        session_search(session);
+    }
+    return session->solution;
+}
+
+// `digit` is '1'..'9' and replaces an existing given of `cell`. '0' and '.'
+// remove the given instead, any other character leaves the session as it is.
+Solution session_add(Session* session, int cell, char digit) {
+    if ((digit == '0') || (digit == '.')) {
+        return session_remove(session, cell);
+    }
+    session->searched = 0;
+    if ((digit < '1') || (digit > '9') || (session->givens[cell] == digit)) {
+        return session->solution;
+    }
+    if (session->givens[cell] != '0') {
+        session_remove(session, cell);
+    }
+
+    session->givens[cell] = digit;
+    session_propagate(session, cell);
+
+    // An unsolvable puzzle stays unsolvable with more givens
+    uint16_t mask = val_to_mask(digit - '1');
+    if (session->solution.is_solved && session->solution.solution.flags[cell] != mask) {
+        session_search(session);
+    }
+    return session->solution;
+}
+
+State make_digits_state(const uint8_t* digits) {
+    State state = make_empty_state();
+
+    for (int idx = 0; idx < 81; ++idx) {
+        if ((digits[idx] >= 1) && (digits[idx] <= 9)) {
+            mark_true(&state.current, idx, val_to_mask(digits[idx] - 1));
+        }
+    }
+
+    return state;
+}
+
+typedef struct Batch {
+    const uint8_t* puzzles;
+    uint8_t* solutions;
+    int64_t* stats;
+    size_t count;
+    size_t next; // Shared between workers, only touched with __atomic builtins
+} Batch;
+
+// Puzzles claimed per __atomic_fetch_add. Hard puzzles take ~1000x longer
+// than easy ones, so chunks are kept small to balance the workers.
+const size_t BATCH_CHUNK = 16ul;
+
+void* solve_batch_worker(void* arg) {
+    Batch* batch = (Batch*) arg;
+
+    while (1) {
+        size_t start = __atomic_fetch_add(&batch->next, BATCH_CHUNK, __ATOMIC_RELAXED);
+        if (start >= batch->count) { break; }
+        size_t end = (start + BATCH_CHUNK < batch->count) ? start + BATCH_CHUNK : batch->count;
+
+        for (size_t puzzle_idx = start; puzzle_idx < end; ++puzzle_idx) {
+            Solution solution = solve_with_engine(
+                make_digits_state(batch->puzzles + puzzle_idx * 81), ENGINE_AUTO
+            );
+
+            uint8_t* output = batch->solutions + puzzle_idx * 81;
+            for (int idx = 0; idx < 81; ++idx) {
+                output[idx] = solution.is_solved
+                            ? __tzcnt_u32(solution.solution.flags[idx]) + 1
+                            : 0;
+            }
+            batch->stats[puzzle_idx * 2 + 0] = solution.is_solved;
+            batch->stats[puzzle_idx * 2 + 1] = solution.nodes;
+        }
+    }
+
+    return NULL;
+}
+
+// Solves `count` puzzles of 81 digits each (0 for an empty cell) on
+// `thread_count` threads, or one per online CPU when `thread_count <= 0`.
+// Writes digits 1..9 to `solutions` (all 0 if unsolved) and the pair
+// (is_solved, nodes) per puzzle to `stats`.
+void solve_batch(const uint8_t* puzzles, uint8_t* solutions, int64_t* stats,
+                 size_t count, int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if ((size_t) thread_count > (count + BATCH_CHUNK - 1) / BATCH_CHUNK) {
+        thread_count = (int) ((count + BATCH_CHUNK - 1) / BATCH_CHUNK);
+    }
+
+    Batch batch = (Batch) {puzzles, solutions, stats, count, 0ul};
+    if (thread_count <= 1) {
+        solve_batch_worker(&batch);
+        return;
+    }
+
+    pthread_t* threads = calloc(sizeof(pthread_t), thread_count);
+    if (threads == NULL) { exit(1); }
+
+    int started = 0;
+    for (; started < thread_count; ++started) {
+        if (pthread_create(&threads[started], NULL, solve_batch_worker, &batch) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        solve_batch_worker(&batch);
+    }
+    for (int idx = 0; idx < started; ++idx) {
+        pthread_join(threads[idx], NULL);
+    }
+    free(threads);
+}
+
+int64_t monotonic_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000000l + now.tv_nsec;
+}
+
+void print_perf_header() {
+    printf("# puzzle\tnodes\tns");
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        printf("\t%s", PERF_COUNTER_NAMES[counter]);
+    }
+    printf("\tipc\trunning\n");
+}
+
+// Values are divided by `count`, IPC is over the whole sample. Counters that
+// could not be opened are printed as "-". The last column is the share of the
+// sample the group spent on the PMU: below 100% the counts are short, and at
+// 0% they are all zero, so IPC is printed as "-".
+void print_perf_sample(const char* label, const PerfCounters* counters, PerfSample sample,
+                       int64_t nodes, int64_t ns, int64_t count) {
+    double scale = count ? 1.0 / (double) count : 0.0;
+    printf("%s\t%.1f\t%.1f", label, (double) nodes * scale, (double) ns * scale);
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        if (counters->fds[counter] >= 0) {
+            printf("\t%.1f", (double) sample.values[counter] * scale);
+        } else {
+            printf("\t-");
+        }
+    }
+    if ((counters->fds[PERF_CYCLES] >= 0) && (counters->fds[PERF_INSTRUCTIONS] >= 0)
+            && (sample.running > 0)) {
+        printf("\t%.3f", perf_ipc(sample));
+    } else {
+        printf("\t-");
+    }
+    if (counters->leader >= 0) {
+        double running = sample.enabled ? (double) sample.running / (double) sample.enabled : 0.0;
+        printf("\t%.1f%%%s\n", 100.0 * running, perf_is_partial(sample) ? " partial" : "");
+    } else {
+        printf("\t-\n");
+    }
+}
+
+// Maps `filename` read-only and stores its size in `size`. Empty files are not
+// mapped and give NULL. Exits with 5 if the file cannot be opened or mapped.
+char* map_file(const char* filename, int64_t* size) {
     struct stat statbuf;
     int fd = open(filename, O_RDONLY);
-    if (fd == 0) { exit(5); }
-    fstat(fd, &statbuf);
+    if (fd < 0) { exit(5); }
+    if (fstat(fd, &statbuf) != 0) { exit(5); }
 
-    int64_t buffer_size = statbuf.st_size;
-    char* buffer = (char*) calloc(sizeof(char), buffer_size);
-    read(fd, buffer, buffer_size);
+    *size = statbuf.st_size;
+    char* buffer = (*size > 0)
+                 ? mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0)
+                 : NULL;
     close(fd);
+    if (buffer == MAP_FAILED) { exit(5); }
+    return buffer;
+}
 
-    char* current = buffer;
-    int64_t remaining_size = buffer_size;
-    int64_t step = has_solution
-                 ? (81 + 1 /* comma */ + 81 + 1 /* newline */)
-                 : (81 + 1);
-
-    // Skip lines which are comments
-    while ((remaining_size > 0) && *current == '#') {
-        ++current;
-        --remaining_size;
-        while (remaining_size && *current != '\n') {
-            ++current;
-            --remaining_size;
+// Offset of the first line after the leading `#` comment lines.
+int64_t skip_comments(const char* buffer, int64_t buffer_size) {
+    int64_t offset = 0;
+    while ((offset < buffer_size) && buffer[offset] == '#') {
+        while ((offset < buffer_size) && buffer[offset] != '\n') {
+            ++offset;
         }
-        ++current;
-        --remaining_size;
+        ++offset;
+    }
+    return (offset < buffer_size) ? offset : buffer_size;
+}
+
+// Moves `offset` forward to the start of a line. A line belongs to the shard
+// its first byte falls in, so adjacent shards never share or drop a line.
+int64_t align_to_line(const char* buffer, int64_t buffer_size, int64_t begin, int64_t offset) {
+    if (offset <= begin) { return begin; }
+    while ((offset < buffer_size) && buffer[offset - 1] != '\n') {
+        ++offset;
     }
+    return (offset < buffer_size) ? offset : buffer_size;
+}
 
-    while (remaining_size > step) {
+// Bytes [begin, end) of shard `index` of `count` over the lines from
+// `data_begin` on. The data is split evenly by size and each cut moved to the
+// next line start, so every line lands in exactly one shard and shards past
+// the last line are empty.
+void shard_range(const char* buffer, int64_t buffer_size, int64_t data_begin,
+                 int index, int count, int64_t* begin, int64_t* end) {
+    int64_t data_size = buffer_size - data_begin;
+    int64_t shard_begin = data_begin + data_size * index / count;
+    int64_t shard_end = data_begin + data_size * (index + 1) / count;
+
+    *end = align_to_line(buffer, buffer_size, data_begin, shard_end);
+    *begin = align_to_line(buffer, buffer_size, data_begin, shard_begin);
+}
+
+void write_shard_header(FILE* file, const Options* options, int64_t begin, int64_t end) {
+    fprintf(file, "# shard %d/%d bytes %ld-%ld\n",
+            options->shard_index, options->shard_count, begin, end);
+}
+
+void write_shard_stats(FILE* file, ShardStats stats) {
+    fprintf(file, "# stats puzzles=%ld solved=%ld nodes=%ld ns=%ld stored=%ld\n",
+            stats.puzzles, stats.solved, stats.nodes, stats.ns, stats.stored);
+}
+
+void solve_from_csv(const char* filename, int has_solution, const Options* options) {
+    // Mapped rather than read so a shard only faults in the pages it solves
+    int64_t buffer_size = 0;
+    char* buffer = map_file(filename, &buffer_size);
+
+    int64_t record_size = has_solution
+                        ? (81 + 1 /* comma */ + 81)
+                        : 81;
+    int64_t step = record_size + 1 /* newline */;
+
+    int64_t begin = skip_comments(buffer, buffer_size);
+    int64_t end = buffer_size;
+    if (options->shard_count > 0) {
+        shard_range(buffer, buffer_size, begin, options->shard_index, options->shard_count,
+                    &begin, &end);
+    }
+    if (end > begin) {
+        int64_t page_size = sysconf(_SC_PAGESIZE);
+        int64_t page_begin = begin / page_size * page_size;
+        madvise(buffer + page_begin, end - page_begin, MADV_SEQUENTIAL);
+    }
+
+    FILE* shard_file = NULL;
+    if (options->shard_count > 0) {
+        char default_output[4096];
+        snprintf(default_output, sizeof(default_output), "%s.shard-%d-of-%d",
+                 filename, options->shard_index, options->shard_count);
+        shard_file = fopen(options->output ? options->output : default_output, "w");
+        if (shard_file == NULL) { exit(5); }
+        write_shard_header(shard_file, options, begin, end);
+    }
+    ShardStats stats = (ShardStats) {0, 0, 0, 0, 0};
+    int64_t shard_start_ns = monotonic_ns();
+
+    PerfCounters counters;
+    PerfSample perf_total;
+    int64_t puzzle_count = 0;
+    int64_t node_total = 0;
+    int64_t ns_total = 0;
+    int64_t partial_count = 0; // Samples the group was not running for all of
+    if (options->perf_counters) {
+        counters = perf_open();
+        memset(&perf_total, 0, sizeof(perf_total));
+        print_perf_header();
+    }
+
+    int64_t store_hits = 0;
+    const char* current = buffer + begin;
+    int64_t puzzle_idx = 0;
+    while ((buffer + end) - current >= record_size) {
         const char* problem_ptr = current;
 
         current += step;
-        remaining_size -= step;
 
-        Solution candidate = solve_one(problem_ptr);
+        Solution candidate;
+        int is_hit = 0;
+        if (options->perf_counters) {
+            int64_t start_ns = monotonic_ns();
+            PerfSample start = perf_read(&counters);
+            candidate = (options->store != NULL)
+                      ? solve_one_stored(problem_ptr, options->engine, options->store, &is_hit)
+                      : solve_one_with(problem_ptr, options->engine);
+            PerfSample sample = perf_delta(perf_read(&counters), start);
+            int64_t ns = monotonic_ns() - start_ns;
+
+            // Store hits are only a lookup, the mean covers searched puzzles
+            char label[32];
+            snprintf(label, sizeof(label), "%ld%s", puzzle_idx, is_hit ? " stored" : "");
+            print_perf_sample(label, &counters, sample, candidate.nodes, ns, 1);
+
+            if (!is_hit) {
+                perf_accumulate(&perf_total, sample);
+                partial_count += (counters.leader >= 0) && perf_is_partial(sample);
+                node_total += candidate.nodes;
+                ns_total += ns;
+                puzzle_count += 1;
+            }
+        } else if (options->store != NULL) {
+            candidate = solve_one_stored(problem_ptr, options->engine, options->store, &is_hit);
+        } else {
+            candidate = solve_one_with(problem_ptr, options->engine);
+        }
+        store_hits += is_hit;
+        ++puzzle_idx;
 
         if (DEBUG_VERIFY >= 1) {
             debug_verify(&candidate.solution);
         }
 
-        if (has_solution) {
+        if (shard_file != NULL) {
+            // Unsolved puzzles are recorded in the result file instead of
+            // failing the whole shard
+            fprint_solution(shard_file, candidate);
+            stats.puzzles += 1;
+            stats.solved += candidate.is_solved;
+            stats.nodes += candidate.nodes;
+            stats.stored += is_hit;
+        } else if (has_solution) {
             const char* solution_ptr = problem_ptr + 81 + 1 /* comma */;
             Board solution = make_solution_board(solution_ptr);
 
@@ -497,11 +992,395 @@ void solve_from_csv(const char* filename, int has_solution) {
         }
     }
 
-    free(buffer);
+    if (options->perf_counters) {
+        printf("# %s: %ld puzzles searched, %d/%d counters, %ld partial samples\n",
+               filename, puzzle_count, counters.available, PERF_COUNTER_COUNT, partial_count);
+        print_perf_sample("# mean", &counters, perf_total, node_total, ns_total, puzzle_count);
+        perf_close(&counters);
+    }
+
+    if (options->store != NULL) {
+        printf("# %s: %ld of %ld puzzles from the store\n", filename, store_hits, puzzle_idx);
+    }
+
+    if (shard_file != NULL) {
+        stats.ns = monotonic_ns() - shard_start_ns;
+        write_shard_stats(shard_file, stats);
+        fclose(shard_file);
+    }
+
+    if (buffer != NULL) {
+        munmap(buffer, buffer_size);
+    }
+}
+
+// Checks the grids of `filename` with `validate_grid`, one per line, either
+// `grid` or `puzzle,grid`. Prints every invalid line with its failed houses
+// and returns the number of invalid grids.
+int64_t validate_from_csv(const char* filename) {
+    int64_t buffer_size = 0;
+    char* buffer = map_file(filename, &buffer_size);
+
+    int64_t begin = skip_comments(buffer, buffer_size);
+    int has_puzzle = (buffer_size - begin > 81) && (buffer[begin + 81] == ',');
+    int64_t record_size = has_puzzle
+                        ? (81 + 1 /* comma */ + 81)
+                        : 81;
+    int64_t step = record_size + 1 /* newline */;
+    int64_t grid_offset = has_puzzle ? 81 + 1 /* comma */ : 0;
+
+    int64_t grid_count = 0;
+    int64_t invalid_count = 0;
+    int64_t start_ns = monotonic_ns();
+
+    int64_t total = (buffer_size - begin >= record_size)
+                  ? (buffer_size - begin - record_size) / step + 1
+                  : 0;
+    uint32_t results[4096];
+    while (grid_count < total) {
+        int64_t chunk = (total - grid_count < 4096) ? total - grid_count : 4096;
+        const char* current = buffer + begin + grid_count * step;
+        validate_grids(current + grid_offset, has_puzzle ? current : NULL, step, chunk, results);
+
+        for (int64_t idx = 0; idx < chunk; ++idx) {
+            if (results[idx]) {
+                char description[512];
+                describe_validation(results[idx], description, sizeof(description));
+                printf("%ld: %s\n", grid_count + idx, description);
+                ++invalid_count;
+            }
+        }
+        grid_count += chunk;
+    }
+
+    int64_t ns = monotonic_ns() - start_ns;
+    printf("# %s: %ld grids, %ld invalid, %.1f M grids/s\n", filename, grid_count,
+           invalid_count, ns ? (double) grid_count * 1000.0 / (double) ns : 0.0);
+
+    if (buffer != NULL) {
+        munmap(buffer, buffer_size);
+    }
+    return invalid_count;
+}
+
+// Removes and re-adds every given of each puzzle in `filename` through a
+// `Session`, then adds one given that contradicts the solution, checking each
+// edited solution. Prints the mean latency of each kind of edit next to a full
+// `solve_one_with` of the edited puzzle. Returns the number of edits whose
+// solution was wrong.
+int64_t session_bench_from_csv(const char* filename, const Options* options) {
+    int64_t buffer_size = 0;
+    char* buffer = map_file(filename, &buffer_size);
+
+    int64_t step = 81 + 1 /* newline */;
+    int64_t begin = skip_comments(buffer, buffer_size);
+
+    Session session;
+    int64_t puzzle_count = 0;
+    int64_t edit_count = 0;
+    int64_t wrong_count = 0;
+    int64_t conflict_count = 0;
+    int64_t remove_searches = 0, add_searches = 0, conflict_searches = 0;
+    int64_t start_ns = 0, remove_ns = 0, add_ns = 0, conflict_ns = 0;
+    int64_t full_remove_ns = 0, full_add_ns = 0, full_conflict_ns = 0;
+
+    for (int64_t offset = begin; buffer_size - offset >= 81; offset += step) {
+        const char* problem = buffer + offset;
+        char edited[81];
+        char chars[81];
+
+        int64_t before_ns = monotonic_ns();
+        session_start(&session, problem, options->engine);
+        start_ns += monotonic_ns() - before_ns;
+        memcpy(edited, session.givens, 81);
+
+        before_ns = monotonic_ns();
+        Solution full = solve_one_with(edited, options->engine);
+        int64_t full_ns = monotonic_ns() - before_ns;
+
+        for (int cell = 0; cell < 81; ++cell) {
+            char digit = edited[cell];
+            if (digit == '0') { continue; }
+
+            edited[cell] = '0';
+            before_ns = monotonic_ns();
+            Solution removed = session_remove(&session, cell);
+            remove_ns += monotonic_ns() - before_ns;
+            remove_searches += session.searched;
+
+            before_ns = monotonic_ns();
+            Solution expected = solve_one_with(edited, options->engine);
+            full_remove_ns += monotonic_ns() - before_ns;
+
+            solution_to_chars(removed, chars);
+            wrong_count += (removed.is_solved != expected.is_solved)
+                        || (removed.is_solved && validate_grid(chars, edited));
+
+            edited[cell] = digit;
+            before_ns = monotonic_ns();
+            Solution added = session_add(&session, cell, digit);
+            add_ns += monotonic_ns() - before_ns;
+            add_searches += session.searched;
+            full_add_ns += full_ns;
+
+            solution_to_chars(added, chars);
+            wrong_count += (added.is_solved != full.is_solved)
+                        || (added.is_solved && validate_grid(chars, edited));
+            ++edit_count;
+        }
+
+        // A given that disagrees with the cached solution has to search
+        int empty = 0;
+        while (empty < 81 && edited[empty] != '0') { ++empty; }
+        if (empty < 81 && full.is_solved) {
+            char digit = '1' + (__tzcnt_u32(full.solution.flags[empty]) + 1) % 9;
+            edited[empty] = digit;
+            before_ns = monotonic_ns();
+            Solution conflict = session_add(&session, empty, digit);
+            conflict_ns += monotonic_ns() - before_ns;
+            conflict_searches += session.searched;
+
+            before_ns = monotonic_ns();
+            Solution expected = solve_one_with(edited, options->engine);
+            full_conflict_ns += monotonic_ns() - before_ns;
+
+            solution_to_chars(conflict, chars);
+            wrong_count += (conflict.is_solved != expected.is_solved)
+                        || (conflict.is_solved && validate_grid(chars, edited));
+            session_remove(&session, empty);
+            ++conflict_count;
+        }
+        ++puzzle_count;
+    }
+
+    double edits = edit_count ? (double) edit_count : 1.0;
+    printf("# %s: %ld puzzles, %ld edits, %ld wrong\n", filename, puzzle_count,
+           2 * edit_count + conflict_count, wrong_count);
+    printf("# start   %9.0f ns/puzzle\n", puzzle_count ? (double) start_ns / puzzle_count : 0.0);
+    printf("# remove  %9.0f ns/edit (full re-solve %9.0f ns), %.1f%% searched\n",
+           remove_ns / edits, full_remove_ns / edits, 100.0 * remove_searches / edits);
+    printf("# add     %9.0f ns/edit (full re-solve %9.0f ns), %.1f%% searched\n",
+           add_ns / edits, full_add_ns / edits, 100.0 * add_searches / edits);
+    double conflicts = conflict_count ? (double) conflict_count : 1.0;
+    printf("# conflict%9.0f ns/edit (full re-solve %9.0f ns), %.1f%% searched\n",
+           conflict_ns / conflicts, full_conflict_ns / conflicts,
+           100.0 * conflict_searches / conflicts);
+
+    if (buffer != NULL) {
+        munmap(buffer, buffer_size);
+    }
+    return wrong_count;
 }
 
+typedef struct ShardFile {
+    char* buffer;
+    int64_t buffer_size;
+    int index;
+    int count;
+    int64_t begin;
+    int64_t end;
+    int64_t body_begin; // Solutions are [body_begin, body_end)
+    int64_t body_end;
+    ShardStats stats;
+} ShardFile;
+
+int compare_shards(const void* lhs, const void* rhs) {
+    return ((const ShardFile*) lhs)->index - ((const ShardFile*) rhs)->index;
+}
+
+// Copies buffer[begin, end) into the NUL terminated `line`, truncated to fit
+// `size`, so it can be parsed without reading past a mapping.
+void copy_line(const char* buffer, int64_t begin, int64_t end, char* line, int64_t size) {
+    int64_t length = (end - begin < size - 1) ? end - begin : size - 1;
+    memcpy(line, buffer + begin, length);
+    line[length] = '\0';
+}
+
+#define SHARD_OK 0
+#define SHARD_NO_HEADER 1
+#define SHARD_NO_FOOTER 2 // Also when the shard did not finish
+
+// Reads the header, body and footer of the shard result in `shard->buffer`.
+// Both lines must be complete, newline included, so a file cut off while it
+// was written is never taken for a finished shard.
+int parse_shard(ShardFile* shard) {
+    // The mapping is not NUL terminated, lines are parsed from a copy
+    char line[128];
+    shard->body_begin = 0;
+    while ((shard->body_begin < shard->buffer_size) && shard->buffer[shard->body_begin] != '\n') {
+        ++shard->body_begin;
+    }
+    copy_line(shard->buffer, 0, shard->body_begin, line, sizeof(line));
+    int parsed = sscanf(line, "# shard %d/%d bytes %ld-%ld",
+                        &shard->index, &shard->count, &shard->begin, &shard->end);
+    if ((parsed != 4) || (shard->body_begin >= shard->buffer_size)) {
+        return SHARD_NO_HEADER;
+    }
+    ++shard->body_begin;
+
+    // The footer is the last line, written once the shard finished
+    if (shard->buffer[shard->buffer_size - 1] != '\n') {
+        return SHARD_NO_FOOTER;
+    }
+    int64_t footer = shard->buffer_size - 1;
+    while ((footer > shard->body_begin) && shard->buffer[footer - 1] != '\n') {
+        --footer;
+    }
+    copy_line(shard->buffer, footer, shard->buffer_size - 1, line, sizeof(line));
+    // `stored` is missing from shards written before it was added
+    parsed = sscanf(line, "# stats puzzles=%ld solved=%ld nodes=%ld ns=%ld stored=%ld",
+                    &shard->stats.puzzles, &shard->stats.solved,
+                    &shard->stats.nodes, &shard->stats.ns, &shard->stats.stored);
+    if (footer < shard->body_begin || parsed < 4) {
+        return SHARD_NO_FOOTER;
+    }
+    shard->body_end = footer;
+    return SHARD_OK;
+}
+
+ShardFile open_shard(const char* filename) {
+    ShardFile shard;
+    memset(&shard, 0, sizeof(shard));
+
+    shard.buffer = map_file(filename, &shard.buffer_size);
+    if (shard.buffer == NULL) { exit(5); }
+
+    int result = parse_shard(&shard);
+    if (result == SHARD_NO_HEADER) {
+        fprintf(stderr, "%s: missing shard header\n", filename);
+        exit(7);
+    } else if (result == SHARD_NO_FOOTER) {
+        fprintf(stderr, "%s: missing stats footer, shard did not finish\n", filename);
+        exit(7);
+    }
+    return shard;
+}
+
+// `solver merge OUTPUT SHARD...`: concatenates the shard results in shard
+// order and sums their stats. Fails unless every shard 0..N-1 is present and
+// their byte ranges are contiguous.
+void merge_shards(const char* output, int shard_count, char* filenames[]) {
+    ShardFile* shards = calloc(sizeof(ShardFile), shard_count);
+    if (shards == NULL) { exit(1); }
+    for (int idx = 0; idx < shard_count; ++idx) {
+        shards[idx] = open_shard(filenames[idx]);
+    }
+    qsort(shards, shard_count, sizeof(ShardFile), compare_shards);
+
+    for (int idx = 0; idx < shard_count; ++idx) {
+        int is_contiguous = (idx == 0) || (shards[idx - 1].end == shards[idx].begin);
+        if ((shards[idx].index != idx) || (shards[idx].count != shard_count) || !is_contiguous) {
+            fprintf(stderr, "Expected shard %d/%d, got %d/%d bytes %ld-%ld\n",
+                    idx, shard_count, shards[idx].index, shards[idx].count,
+                    shards[idx].begin, shards[idx].end);
+            exit(7);
+        }
+    }
+
+    FILE* file = fopen(output, "w");
+    if (file == NULL) { exit(5); }
+
+    ShardStats total = (ShardStats) {0, 0, 0, 0, 0};
+    for (int idx = 0; idx < shard_count; ++idx) {
+        ShardFile* shard = &shards[idx];
+        fwrite(shard->buffer + shard->body_begin, 1, shard->body_end - shard->body_begin, file);
+
+        total.puzzles += shard->stats.puzzles;
+        total.solved += shard->stats.solved;
+        total.nodes += shard->stats.nodes;
+        total.ns += shard->stats.ns; // CPU time summed over shards, not wall time
+        total.stored += shard->stats.stored;
+
+        munmap(shard->buffer, shard->buffer_size);
+    }
+    write_shard_stats(file, total);
+    fclose(file);
+
+    write_shard_stats(stdout, total);
+    free(shards);
+}
+
+#ifndef SOLVER_NO_MAIN
 int main(int argc, char *argv[]) {
+    Options options = (Options) {ENGINE_AUTO, 0, 0, NULL, 0, 0, NULL, 0};
+    int64_t invalid_count = 0;
+    int input_count = 0; // Inputs solved so far
+    Store store;
+    uint64_t store_cap = DEFAULT_STORE_CAP;
+
+    if (argc >= 3 && strcmp(argv[1], "merge") == 0) {
+        merge_shards(argv[2], argc - 3, argv + 3);
+        return 0;
+    }
+    if (argc >= 3 && strcmp(argv[1], "store-compact") == 0) {
+        struct stat statbuf;
+        uint64_t max_count = (argc >= 4) ? strtoull(argv[3], NULL, 10) : 0;
+        int64_t kept = (stat(argv[2], &statbuf) == 0) ? store_compact(argv[2], max_count) : -1;
+        if (kept < 0) {
+            fprintf(stderr, "Could not compact %s\n", argv[2]);
+            exit(5);
+        }
+        printf("# %s: %ld entries kept\n", argv[2], kept);
+        return 0;
+    }
+
     for (int idx = 1; idx < argc; ++idx) {
-        solve_from_csv(argv[idx], 0);
+        if (strcmp(argv[idx], "--engine") == 0 && idx + 1 < argc) {
+            ++idx;
+            if (strcmp(argv[idx], "dfs") == 0) {
+                options.engine = ENGINE_DFS;
+            } else if (strcmp(argv[idx], "dlx") == 0) {
+                options.engine = ENGINE_DLX;
+            } else if (strcmp(argv[idx], "auto") == 0) {
+                options.engine = ENGINE_AUTO;
+            } else {
+                fprintf(stderr, "Unknown engine: %s\n", argv[idx]);
+                exit(6);
+            }
+        } else if (strcmp(argv[idx], "--perf-counters") == 0) {
+            options.perf_counters = 1;
+        } else if (strcmp(argv[idx], "--validate") == 0) {
+            options.validate = 1;
+        } else if (strcmp(argv[idx], "--session-bench") == 0) {
+            options.session_bench = 1;
+        } else if (strcmp(argv[idx], "--shard") == 0 && idx + 1 < argc) {
+            ++idx;
+            int parsed = sscanf(argv[idx], "%d/%d", &options.shard_index, &options.shard_count);
+            if (parsed != 2 || options.shard_index < 0
+                    || options.shard_index >= options.shard_count) {
+                fprintf(stderr, "Expected --shard i/N with 0 <= i < N, got %s\n", argv[idx]);
+                exit(6);
+            }
+        } else if (strcmp(argv[idx], "--store-cap") == 0 && idx + 1 < argc) {
+            ++idx;
+            store_cap = strtoull(argv[idx], NULL, 10);
+        } else if (strcmp(argv[idx], "--store") == 0 && idx + 1 < argc) {
+            ++idx;
+            if (options.store != NULL || store_open(&store, argv[idx], store_cap) != 0) {
+                fprintf(stderr, "Could not open store %s\n", argv[idx]);
+                exit(5);
+            }
+            options.store = &store;
+        } else if (strcmp(argv[idx], "--output") == 0 && idx + 1 < argc) {
+            ++idx;
+            options.output = argv[idx];
+        } else if (options.validate) {
+            invalid_count += validate_from_csv(argv[idx]);
+        } else if (options.session_bench) {
+            invalid_count += session_bench_from_csv(argv[idx], &options);
+        } else {
+            ++input_count;
+            if (options.output != NULL && input_count > 1) {
+                fprintf(stderr, "--output takes a single input, got %s as well\n", argv[idx]);
+                exit(6);
+            }
+            solve_from_csv(argv[idx], 0, &options);
+        }
     }
+
+    if (options.store != NULL) {
+        store_close(options.store);
+    }
+    return invalid_count ? 8 : 0;
 }
+#endif
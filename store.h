@@ -0,0 +1,343 @@
+#include <errno.h> // errno, EEXIST
+#include <fcntl.h> // open
+#include <stdint.h> // uint*_t
+#include <stdio.h> // snprintf, rename
+#include <stdlib.h> // calloc, qsort
+#include <string.h> // memset
+#include <unistd.h> // ftruncate, link, unlink, getpid
+
+#include <sys/file.h> // flock
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+
+// Solutions shared across runs and processes through one memory-mapped file:
+// an open addressed hash table from a 128 bit digest of the puzzle and a
+// caller chosen `variant` (the engine, since engines can find different
+// solutions and count nodes differently) to the packed solution and node
+// count.
+//
+// Readers never lock. Writers claim an empty slot with a compare-and-swap on
+// `key`, fill it and publish it by storing the real key with release order,
+// so a reader that sees the key also sees the payload. Slots left claimed by
+// a crashed writer stay STORE_BUSY and are dropped by `store_compact`.
+//
+// The table never grows: inserts stop once `max_count` slots are used.
+// `store_compact` rewrites the file with the most recently used entries and
+// renames it into place; processes that still map the old file keep working
+// on it, so compaction is meant to run between batch jobs.
+//
+// Recency is the header generation, bumped by every `store_open`, as of the
+// last lookup of each entry. Slots keep its low 32 bits and ages are compared
+// modulo 2^32, so `store_compact` ranks entries correctly as long as none was
+// last used more than 2^31 opens ago.
+
+#define STORE_MAGIC 0x3254535545444f53ul // "SODEUST2"
+#define STORE_EMPTY 0ul
+#define STORE_BUSY 1ul
+
+typedef struct StoreHeader {
+    uint64_t magic;
+    uint64_t capacity; // Slots, a power of two
+    uint64_t max_count; // Size cap
+    uint64_t count; // Claimed slots, only touched with __atomic builtins
+    uint64_t generation; // Bumped by every `store_open`
+    uint64_t pad[3];
+} StoreHeader;
+
+typedef struct StoreSlot {
+    uint64_t key; // Low half of the digest, never STORE_EMPTY or STORE_BUSY
+    uint64_t check; // High half of the digest
+    uint32_t nodes;
+    uint32_t generation; // Of the last run that used the entry
+    // Two digits per byte for cells 0..79, all zero if unsolved. Cell 80 is
+    // the digit missing from the rest of the last row.
+    uint8_t solution[40];
+} StoreSlot;
+
+_Static_assert(sizeof(StoreHeader) == 64, "StoreHeader must fill one cache line");
+_Static_assert(sizeof(StoreSlot) == 64, "StoreSlot must fill one cache line");
+
+typedef struct Store {
+    int fd;
+    StoreHeader* header;
+    StoreSlot* slots;
+    size_t map_size;
+    uint32_t generation;
+} Store;
+
+typedef struct StoreDigest {
+    uint64_t key;
+    uint64_t check;
+} StoreDigest;
+
+uint64_t store_mix(uint64_t value) {
+    // splitmix64 finalizer
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ul;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebul;
+    value ^= value >> 31;
+    return value;
+}
+
+// '0' and '.' are the same empty cell.
+StoreDigest store_digest(const char* puzzle, uint32_t variant) {
+    uint64_t words[6] = {0, 0, 0, 0, 0, 0};
+    for (int idx = 0; idx < 81; ++idx) {
+        uint64_t digit = (puzzle[idx] >= '1' && puzzle[idx] <= '9') ? puzzle[idx] - '0' : 0;
+        words[idx / 16] |= digit << ((idx % 16) * 4);
+    }
+
+    StoreDigest digest = (StoreDigest) {0x9e3779b97f4a7c15ul, 0xc2b2ae3d27d4eb4ful};
+    for (int idx = 0; idx < 6; ++idx) {
+        digest.key = store_mix(digest.key ^ words[idx]);
+        digest.check = store_mix(digest.check + words[idx]);
+    }
+    digest.key = store_mix(digest.key ^ variant);
+    digest.check = store_mix(digest.check + variant);
+    digest.key = (digest.key > STORE_BUSY) ? digest.key : digest.key + 2;
+    return digest;
+}
+
+size_t store_file_size(uint64_t capacity) {
+    return sizeof(StoreHeader) + capacity * sizeof(StoreSlot);
+}
+
+// Smallest power of two keeping `max_count` entries at most 3/4 full.
+uint64_t store_capacity_for(uint64_t max_count) {
+    uint64_t capacity = 64;
+    while (capacity * 3 / 4 < max_count) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+// Writes an empty store to a temporary file and links it to `path`, so other
+// processes either see no file or a complete header. Losing the race to
+// another creator is fine.
+int store_create(const char* path, uint64_t max_count) {
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%d", path, (int) getpid());
+
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { return -1; }
+
+    uint64_t capacity = store_capacity_for(max_count);
+    StoreHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = STORE_MAGIC;
+    header.capacity = capacity;
+    header.max_count = max_count;
+
+    // Slots stay sparse zero pages (STORE_EMPTY) until written
+    int failed = (ftruncate(fd, store_file_size(capacity)) != 0)
+              || (pwrite(fd, &header, sizeof(header), 0) != sizeof(header));
+    close(fd);
+
+    if (!failed && link(tmp_path, path) != 0 && errno != EEXIST) {
+        failed = 1;
+    }
+    unlink(tmp_path);
+    return failed ? -1 : 0;
+}
+
+// Opens `path`, creating it with room for `max_count` entries if missing.
+// Returns 0 on success.
+int store_open(Store* store, const char* path, uint64_t max_count) {
+    memset(store, 0, sizeof(*store));
+    store->fd = -1;
+
+    int fd = open(path, O_RDWR);
+    if (fd < 0 && errno == ENOENT) {
+        if (store_create(path, max_count) != 0) { return -1; }
+        fd = open(path, O_RDWR);
+    }
+    if (fd < 0) { return -1; }
+
+    StoreHeader header;
+    struct stat statbuf;
+    if ((pread(fd, &header, sizeof(header), 0) != sizeof(header))
+            || (header.magic != STORE_MAGIC)
+            || (header.capacity & (header.capacity - 1))
+            || (fstat(fd, &statbuf) != 0)
+            || ((uint64_t) statbuf.st_size < store_file_size(header.capacity))) {
+        close(fd);
+        return -1;
+    }
+
+    size_t map_size = store_file_size(header.capacity);
+    void* data = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    store->fd = fd;
+    store->header = (StoreHeader*) data;
+    store->slots = (StoreSlot*) ((char*) data + sizeof(StoreHeader));
+    store->map_size = map_size;
+    store->generation = (uint32_t) (__atomic_fetch_add(&store->header->generation, 1, __ATOMIC_RELAXED) + 1);
+    return 0;
+}
+
+void store_close(Store* store) {
+    if (store->header != NULL) {
+        munmap(store->header, store->map_size);
+    }
+    if (store->fd >= 0) {
+        close(store->fd);
+    }
+    memset(store, 0, sizeof(*store));
+    store->fd = -1;
+}
+
+void store_pack(const char* solution, uint8_t* packed) {
+    memset(packed, 0, 40);
+    if (solution == NULL) { return; }
+    for (int idx = 0; idx < 80; ++idx) {
+        packed[idx / 2] |= (uint8_t) ((solution[idx] - '0') << ((idx % 2) * 4));
+    }
+}
+
+// Returns 1 if `puzzle` is stored under `variant`, with its solution written to
+// `solution` (81 characters, left untouched if it was unsolvable) and the node
+// count of the search that stored it to `nodes`. `is_solved` is set
+// accordingly.
+int store_lookup(Store* store, const char* puzzle, uint32_t variant, char* solution,
+                 int* is_solved, uint32_t* nodes) {
+    StoreDigest digest = store_digest(puzzle, variant);
+    uint64_t mask = store->header->capacity - 1;
+
+    for (uint64_t probe = 0; probe <= mask; ++probe) {
+        StoreSlot* slot = &store->slots[(digest.key + probe) & mask];
+        uint64_t key = __atomic_load_n(&slot->key, __ATOMIC_ACQUIRE);
+
+        if (key == STORE_EMPTY) {
+            return 0;
+        } else if (key != digest.key || slot->check != digest.check) {
+            continue;
+        }
+
+        *nodes = slot->nodes;
+        *is_solved = slot->solution[0] != 0;
+        if (*is_solved) {
+            int row_sum = 0;
+            for (int idx = 0; idx < 80; ++idx) {
+                int digit = (slot->solution[idx / 2] >> ((idx % 2) * 4)) & 0xF;
+                solution[idx] = '0' + digit;
+                row_sum += (idx >= 72) ? digit : 0;
+            }
+            solution[80] = '0' + (45 - row_sum);
+        }
+        if (slot->generation != store->generation) {
+            __atomic_store_n(&slot->generation, store->generation, __ATOMIC_RELAXED);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+// Adds `puzzle` under `variant` with its `solution` (81 characters, NULL if
+// unsolvable). Returns 0 if the store is full or the entry is already there.
+int store_insert(Store* store, const char* puzzle, uint32_t variant, const char* solution,
+                 uint32_t nodes) {
+    StoreDigest digest = store_digest(puzzle, variant);
+    uint64_t mask = store->header->capacity - 1;
+
+    for (uint64_t probe = 0; probe <= mask; ++probe) {
+        StoreSlot* slot = &store->slots[(digest.key + probe) & mask];
+        uint64_t key = __atomic_load_n(&slot->key, __ATOMIC_ACQUIRE);
+
+        if (key == digest.key && slot->check == digest.check) {
+            return 0;
+        } else if (key != STORE_EMPTY) {
+            continue;
+        }
+
+        if (__atomic_fetch_add(&store->header->count, 1, __ATOMIC_RELAXED) >= store->header->max_count) {
+            __atomic_fetch_sub(&store->header->count, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+
+        uint64_t expected = STORE_EMPTY;
+        if (!__atomic_compare_exchange_n(&slot->key, &expected, STORE_BUSY, 0,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            // Another writer got this slot first, keep probing
+            __atomic_fetch_sub(&store->header->count, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        slot->check = digest.check;
+        slot->nodes = nodes;
+        slot->generation = store->generation;
+        store_pack(solution, slot->solution);
+        __atomic_store_n(&slot->key, digest.key, __ATOMIC_RELEASE);
+        return 1;
+    }
+    return 0;
+}
+
+int compare_slot_age(const void* lhs, const void* rhs, void* generation_ptr) {
+    uint32_t generation = *(uint32_t*) generation_ptr;
+    uint32_t lhs_age = generation - ((const StoreSlot*) lhs)->generation;
+    uint32_t rhs_age = generation - ((const StoreSlot*) rhs)->generation;
+    return (lhs_age > rhs_age) - (lhs_age < rhs_age);
+}
+
+// Rewrites the store at `path` keeping at most `max_count` of its most
+// recently used entries (or the old cap if `max_count` is 0), then renames the
+// new file over the old one. Returns the number of entries kept, or -1.
+int64_t store_compact(const char* path, uint64_t max_count) {
+    Store old;
+    if (store_open(&old, path, 0) != 0) { return -1; }
+    // Only one compaction at a time, writers are not blocked
+    flock(old.fd, LOCK_EX);
+
+    max_count = max_count ? max_count : old.header->max_count;
+    uint64_t capacity = old.header->capacity;
+    StoreSlot* live = calloc(sizeof(StoreSlot), capacity);
+    if (live == NULL) { exit(1); }
+
+    uint64_t live_count = 0;
+    for (uint64_t idx = 0; idx < capacity; ++idx) {
+        uint64_t key = __atomic_load_n(&old.slots[idx].key, __ATOMIC_ACQUIRE);
+        if (key != STORE_EMPTY && key != STORE_BUSY) {
+            live[live_count] = old.slots[idx];
+            ++live_count;
+        }
+    }
+    qsort_r(live, live_count, sizeof(StoreSlot), compare_slot_age, &old.generation);
+    live_count = (live_count < max_count) ? live_count : max_count;
+
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.compact.%d", path, (int) getpid());
+    unlink(tmp_path);
+
+    Store compacted;
+    int64_t result = -1;
+    if (store_create(tmp_path, max_count) == 0 && store_open(&compacted, tmp_path, 0) == 0) {
+        compacted.header->generation = old.header->generation;
+        uint64_t mask = compacted.header->capacity - 1;
+
+        for (uint64_t idx = 0; idx < live_count; ++idx) {
+            uint64_t slot_idx = live[idx].key & mask;
+            while (compacted.slots[slot_idx].key != STORE_EMPTY) {
+                slot_idx = (slot_idx + 1) & mask;
+            }
+            compacted.slots[slot_idx] = live[idx];
+        }
+        compacted.header->count = live_count;
+
+        msync(compacted.header, compacted.map_size, MS_SYNC);
+        store_close(&compacted);
+        result = (rename(tmp_path, path) == 0) ? (int64_t) live_count : -1;
+    }
+    if (result < 0) {
+        unlink(tmp_path);
+    }
+
+    free(live);
+    flock(old.fd, LOCK_UN);
+    store_close(&old);
+    return result;
+}
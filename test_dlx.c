@@ -0,0 +1,66 @@
+#include <stdio.h> // printf
+#include <stdlib.h> // exit
+
+#include "dlx.h"
+
+const char* PROBLEM = "004300209005009001070060043006002087190007400050083000600000105003508690042910300";
+const char* SOLUTION = "864371259325849761971265843436192587198657432257483916689734125713528694542916378";
+
+void load_candidates(const char* problem, uint16_t* candidates) {
+    for (int idx = 0; idx < 81; ++idx) {
+        int is_given = (problem[idx] != '0') && (problem[idx] != '.');
+        candidates[idx] = is_given ? (1u << (problem[idx] - '1')) : 0b0111111111;
+    }
+}
+
+void test_solves_from_givens() {
+    uint16_t candidates[81];
+    uint16_t solution[81];
+    int64_t nodes = 0;
+    load_candidates(PROBLEM, candidates);
+
+    int result = dlx_solve(candidates, solution, INT64_MAX, &nodes);
+    if (result != DLX_SOLVED) {
+        printf("result: %d nodes: %ld\n", result, nodes);
+        exit(1);
+    }
+    for (int idx = 0; idx < 81; ++idx) {
+        if (solution[idx] != (1u << (SOLUTION[idx] - '1'))) {
+            printf("idx: %d solution: %.04X\n", idx, (uint32_t) solution[idx]);
+            exit(1);
+        }
+    }
+}
+
+void test_budget_exhausted() {
+    uint16_t candidates[81];
+    uint16_t solution[81];
+    int64_t nodes = 0;
+    load_candidates(PROBLEM, candidates);
+
+    int result = dlx_solve(candidates, solution, 3, &nodes);
+    if (result != DLX_EXHAUSTED || nodes != 3) {
+        printf("result: %d nodes: %ld\n", result, nodes);
+        exit(1);
+    }
+}
+
+void test_contradiction() {
+    uint16_t candidates[81];
+    uint16_t solution[81];
+    int64_t nodes = 0;
+    load_candidates(PROBLEM, candidates);
+    candidates[0] = candidates[2]; // Same digit twice in the first row
+
+    int result = dlx_solve(candidates, solution, INT64_MAX, &nodes);
+    if (result != DLX_NO_SOLUTION) {
+        printf("result: %d nodes: %ld\n", result, nodes);
+        exit(1);
+    }
+}
+
+int main() {
+    test_solves_from_givens();
+    test_budget_exhausted();
+    test_contradiction();
+}
@@ -0,0 +1,58 @@
+#!/usr/bin/env python
+# Smoke test for the `sudoku_solver` extension. Build it first with
+# `python setup.py build_ext --inplace`.
+import sys
+
+import numpy as np
+
+import sudoku_solver
+
+PROBLEM = "004300209005009001070060043006002087190007400050083000600000105003508690042910300"
+SOLUTION = "864371259325849761971265843436192587198657432257483916689734125713528694542916378"
+
+def digits(text):
+    return np.frombuffer(text.encode(), dtype=np.uint8) - ord("0")
+
+def expect_error(error, **kwargs):
+    try:
+        sudoku_solver.solve_batch(**kwargs)
+    except error:
+        return
+    print(f"expected {error.__name__} for {sorted(kwargs)}")
+    sys.exit(1)
+
+def test_solves():
+    puzzles = np.stack([digits(PROBLEM)] * 3)
+    out, stats = sudoku_solver.solve_batch(puzzles, threads=2)
+    if not (out == digits(SOLUTION)).all() or not (stats[:, 0] == 1).all():
+        print(out, stats)
+        sys.exit(1)
+
+def test_preallocated_outputs():
+    puzzles = digits(PROBLEM).reshape(1, 81)
+    out = np.zeros((1, 81), np.uint8)
+    stats = np.zeros((1, 2), np.int64)
+    result = sudoku_solver.solve_batch(puzzles, out=out, stats=stats)
+    if result[0] is not out or result[1] is not stats or stats[0, 0] != 1:
+        print(result)
+        sys.exit(1)
+
+def test_rejects_dtypes():
+    puzzles = digits(PROBLEM).reshape(1, 81)
+    expect_error(TypeError, puzzles=puzzles.astype(np.int8))
+    expect_error(TypeError, puzzles=puzzles, out=np.zeros((1, 81), np.int8))
+    expect_error(TypeError, puzzles=puzzles, stats=np.zeros((1, 2), np.float64))
+    expect_error(TypeError, puzzles=puzzles, stats=np.zeros((1, 2), np.uint64))
+    expect_error(ValueError, puzzles=puzzles, stats=np.zeros((2, 2), np.int64))
+
+def test_rejects_digits():
+    expect_error(ValueError, puzzles=np.full((1, 81), 10, np.uint8))
+    puzzles = digits(PROBLEM).reshape(1, 81).copy()
+    puzzles[0, 80] = 255
+    expect_error(ValueError, puzzles=puzzles)
+
+if __name__ == "__main__":
+    test_solves()
+    test_preallocated_outputs()
+    test_rejects_dtypes()
+    test_rejects_digits()
@@ -0,0 +1,295 @@
+#define SOLVER_NO_MAIN
+#include "solver.c"
+
+void test_stored_solutions() {
+    char path[256];
+    snprintf(path, sizeof(path), "/tmp/test_solver.%d", (int) getpid());
+    unlink(path);
+
+    char unsolvable[81];
+    memcpy(unsolvable, TEST_PROBLEM, 81);
+    unsolvable[0] = TEST_PROBLEM[2]; // Same digit twice in the first row
+
+    Store store;
+    if (store_open(&store, path, 100) != 0) { exit(1); }
+    for (int round = 0; round < 2; ++round) {
+        int is_hit = 0;
+        Solution solved = solve_one_stored(TEST_PROBLEM, ENGINE_AUTO, &store, &is_hit);
+        char chars[81];
+        solution_to_chars(solved, chars);
+        // Answers from the store did not search
+        int64_t nodes = round ? 0 : solve_one(TEST_PROBLEM).nodes;
+        if ((is_hit != round) || !solved.is_solved || (solved.nodes != nodes)
+                || (memcmp(chars, TEST_SOLUTION, 81) != 0)) {
+            printf("round: %d is_hit: %d nodes: %ld solution: %.81s\n",
+                   round, is_hit, solved.nodes, chars);
+            exit(1);
+        }
+
+        Solution unsolved = solve_one_stored(unsolvable, ENGINE_AUTO, &store, &is_hit);
+        if ((is_hit != round) || unsolved.is_solved) {
+            printf("round: %d is_hit: %d is_solved: %d\n", round, is_hit, unsolved.is_solved);
+            exit(1);
+        }
+    }
+
+    // Entries of one engine do not answer for another
+    for (int round = 0; round < 2; ++round) {
+        int is_hit = 0;
+        Solution solved = solve_one_stored(TEST_PROBLEM, ENGINE_DLX, &store, &is_hit);
+        int64_t nodes = round ? 0 : solve_one_with(TEST_PROBLEM, ENGINE_DLX).nodes;
+        if ((is_hit != round) || !solved.is_solved || (solved.nodes != nodes)) {
+            printf("dlx round: %d is_hit: %d nodes: %ld\n", round, is_hit, solved.nodes);
+            exit(1);
+        }
+    }
+    store_close(&store);
+    unlink(path);
+}
+
+// The session's newest checkpoint and solution must match solving `givens`
+// from scratch.
+void check_session(Session* session, const char* step) {
+    Board expected = make_problem_state(session->givens).current;
+    Board* actual = &session->checkpoints[session->given_count];
+    int same_board = memcmp(actual->flags, expected.flags, sizeof(expected.flags)) == 0;
+    // A contradiction can leave different empty cells depending on the order
+    int both_failed = !verify_m256(actual) && !verify_m256(&expected);
+
+    Solution solution = session->solution;
+    char chars[81];
+    solution_to_chars(solution, chars);
+    int is_valid = !solution.is_solved || (validate_grid(chars, session->givens) == 0);
+    int is_solved = solve_one(session->givens).is_solved;
+
+    if ((!same_board && !both_failed) || !is_valid || (solution.is_solved != is_solved)) {
+        printf("%s: givens: %.81s same_board: %d is_valid: %d is_solved: %d/%d\n",
+               step, session->givens, same_board, is_valid, solution.is_solved, is_solved);
+        print_flags(actual);
+        print_flags(&expected);
+        exit(1);
+    }
+}
+
+void test_session_edits() {
+    Session session;
+    session_start(&session, TEST_PROBLEM, ENGINE_AUTO);
+    check_session(&session, "start");
+    int start_count = session.given_count;
+
+    // Removing from the middle of the order replays the givens after it
+    int middle = session.order[start_count / 2];
+    char digit = session.givens[middle];
+    session_remove(&session, middle);
+    check_session(&session, "remove middle");
+    if ((session.given_count != start_count - 1) || session.searched) {
+        printf("given_count: %d searched: %d\n", session.given_count, session.searched);
+        exit(1);
+    }
+    for (int idx = 0; idx < session.given_count; ++idx) {
+        if ((session.order[idx] == middle) || (session.givens[session.order[idx]] == '0')) {
+            printf("order[%d]: %d\n", idx, session.order[idx]);
+            exit(1);
+        }
+    }
+
+    session_add(&session, middle, digit);
+    check_session(&session, "re-add");
+    if ((session.given_count != start_count) || session.searched) {
+        printf("given_count: %d searched: %d\n", session.given_count, session.searched);
+        exit(1);
+    }
+
+    // Replacing a given with every other digit, most of which contradict the
+    // solution and have to search
+    int first = session.order[0];
+    char original = session.givens[first];
+    for (char replacement = '1'; replacement <= '9'; ++replacement) {
+        session_add(&session, first, replacement);
+        check_session(&session, "replace");
+        if ((session.given_count != start_count) || (session.givens[first] != replacement)
+                || (session.order[session.given_count - 1] != first)) {
+            printf("replacement: %c given_count: %d\n", replacement, session.given_count);
+            exit(1);
+        }
+    }
+    session_add(&session, first, original);
+    check_session(&session, "restore");
+
+    // '0' removes, characters other than digits are ignored
+    session_add(&session, first, '0');
+    check_session(&session, "add '0'");
+    session_add(&session, middle, 'x');
+    check_session(&session, "add 'x'");
+    if ((session.given_count != start_count - 1) || (session.givens[middle] != digit)) {
+        printf("given_count: %d\n", session.given_count);
+        exit(1);
+    }
+}
+
+// With few givens most replacements keep the puzzle solvable, so the boards
+// are compared without contradictions.
+void test_session_replace_sparse() {
+    char sparse[81];
+    memset(sparse, '0', 81);
+    for (int idx = 0; idx < 27; ++idx) {
+        sparse[idx] = TEST_PROBLEM[idx];
+    }
+
+    Session session;
+    session_start(&session, sparse, ENGINE_DFS);
+    check_session(&session, "sparse start");
+
+    int middle = session.order[session.given_count / 2];
+    int consistent = 0;
+    for (char replacement = '1'; replacement <= '9'; ++replacement) {
+        session_add(&session, middle, replacement);
+        check_session(&session, "sparse replace");
+        consistent += verify_m256(&session.checkpoints[session.given_count]);
+    }
+    if (consistent < 2) {
+        printf("consistent: %d\n", consistent);
+        exit(1);
+    }
+}
+
+// Splits `text` into `count` shards and checks that they are contiguous and
+// that every line starts in exactly one of them. Returns the shard of the line
+// starting at `probe`, or -1.
+int check_shards(const char* text, int count, int64_t probe) {
+    int64_t size = (int64_t) strlen(text);
+    int64_t data_begin = skip_comments(text, size);
+    int64_t previous_end = data_begin;
+    int probe_shard = -1;
+
+    int* owners = calloc(sizeof(int), size + 1);
+    if (owners == NULL) { exit(1); }
+    for (int index = 0; index < count; ++index) {
+        int64_t begin = 0;
+        int64_t end = 0;
+        shard_range(text, size, data_begin, index, count, &begin, &end);
+        int is_line_start = (begin == data_begin) || (begin == size) || (text[begin - 1] == '\n');
+        if ((begin != previous_end) || (end < begin) || !is_line_start) {
+            printf("count: %d shard: %d bytes %ld-%ld after %ld\n",
+                   count, index, begin, end, previous_end);
+            exit(1);
+        }
+        for (int64_t offset = begin; offset < end; ++offset) {
+            owners[offset] += 1;
+        }
+        if ((probe >= begin) && (probe < end)) {
+            probe_shard = index;
+        }
+        previous_end = end;
+    }
+    if (previous_end != size) {
+        printf("count: %d last shard ends at %ld of %ld\n", count, previous_end, size);
+        exit(1);
+    }
+
+    for (int64_t offset = data_begin; offset < size; ++offset) {
+        int is_line_start = (offset == data_begin) || (text[offset - 1] == '\n');
+        if (is_line_start && (owners[offset] != 1)) {
+            printf("count: %d line at %ld in %d shards\n", count, offset, owners[offset]);
+            exit(1);
+        }
+    }
+    free(owners);
+    return probe_shard;
+}
+
+void test_shard_ranges() {
+    // Four 10 byte lines after a 10 byte comment header
+    const char* text = "# comment\n"
+                       "111111111\n"
+                       "222222222\n"
+                       "333333333\n"
+                       "444444444\n";
+    for (int count = 1; count <= 10; ++count) {
+        check_shards(text, count, -1);
+    }
+
+    // 2 shards cut exactly at the start of the third line, which goes to the
+    // second shard. 3 shards cut the second line after 3 bytes, so it stays
+    // in the first shard, where it starts.
+    if ((check_shards(text, 2, 30) != 1) || (check_shards(text, 2, 20) != 0)
+            || (check_shards(text, 3, 20) != 0) || (check_shards(text, 3, 30) != 1)) {
+        printf("lines moved to the wrong shard\n");
+        exit(1);
+    }
+
+    // No trailing newline, no data, comments only
+    const char* unterminated = "111111111\n222222222\n333";
+    for (int count = 1; count <= 6; ++count) {
+        check_shards(unterminated, count, -1);
+    }
+    if (check_shards(unterminated, 6, 20) != 5) {
+        printf("unterminated last line lost\n");
+        exit(1);
+    }
+    check_shards("", 3, -1);
+    check_shards("# only a comment\n", 3, -1);
+}
+
+int parse_shard_text(const char* text, ShardFile* shard) {
+    memset(shard, 0, sizeof(*shard));
+    shard->buffer = (char*) text;
+    shard->buffer_size = (int64_t) strlen(text);
+    return parse_shard(shard);
+}
+
+void test_parse_shard() {
+    ShardFile shard;
+    const char* complete = "# shard 1/3 bytes 10-30\n"
+                           "111\n"
+                           "222\n"
+                           "# stats puzzles=2 solved=2 nodes=7 ns=100\n";
+    if ((parse_shard_text(complete, &shard) != SHARD_OK)
+            || (shard.index != 1) || (shard.count != 3) || (shard.begin != 10) || (shard.end != 30)
+            || (shard.stats.puzzles != 2) || (shard.stats.nodes != 7) || (shard.stats.ns != 100)
+            || (memcmp(complete + shard.body_begin, "111\n222\n", 8) != 0)
+            || (shard.body_end - shard.body_begin != 8)) {
+        printf("complete shard misparsed\n");
+        exit(1);
+    }
+
+    const char* empty = "# shard 0/3 bytes 10-10\n"
+                        "# stats puzzles=0 solved=0 nodes=0 ns=5\n";
+    if ((parse_shard_text(empty, &shard) != SHARD_OK) || (shard.body_end != shard.body_begin)) {
+        printf("empty shard misparsed\n");
+        exit(1);
+    }
+
+    const char* no_header[] = {
+        "111\n# stats puzzles=1 solved=1 nodes=1 ns=1\n",
+        "# shard 1/3 bytes 10-",
+        "# shard 1/3 bytes 10-30",
+    };
+    for (int idx = 0; idx < 3; ++idx) {
+        if (parse_shard_text(no_header[idx], &shard) != SHARD_NO_HEADER) {
+            printf("no_header[%d] accepted\n", idx);
+            exit(1);
+        }
+    }
+
+    const char* no_footer[] = {
+        "# shard 1/3 bytes 10-30\n",
+        "# shard 1/3 bytes 10-30\n111\n222\n",
+        "# shard 1/3 bytes 10-30\n111\n# stats puzzles=1 solved=1",
+        "# shard 1/3 bytes 10-30\n111\n# stats puzzles=1 solved=1 nodes=1 ns=1",
+    };
+    for (int idx = 0; idx < 4; ++idx) {
+        if (parse_shard_text(no_footer[idx], &shard) != SHARD_NO_FOOTER) {
+            printf("no_footer[%d] accepted\n", idx);
+            exit(1);
+        }
+    }
+}
+
+int main() {
+    test_stored_solutions();
+    test_session_edits();
+    test_session_replace_sparse();
+    test_shard_ranges();
+    test_parse_shard();
+}
@@ -0,0 +1,122 @@
+#define _GNU_SOURCE // qsort_r
+
+#include <stdio.h> // printf
+#include <stdlib.h> // exit
+
+#include "store.h"
+
+const char* PROBLEM = "004300209005009001070060043006002087190007400050083000600000105003508690042910300";
+const char* SOLUTION = "864371259325849761971265843436192587198657432257483916689734125713528694542916378";
+
+void make_path(char* path, size_t size) {
+    snprintf(path, size, "/tmp/test_store.%d", (int) getpid());
+    unlink(path);
+}
+
+void test_insert_lookup() {
+    char path[256];
+    make_path(path, sizeof(path));
+
+    Store store;
+    if (store_open(&store, path, 100) != 0) { exit(1); }
+    if (!store_insert(&store, PROBLEM, 0, SOLUTION, 42)) { exit(1); }
+    if (store_insert(&store, PROBLEM, 0, SOLUTION, 42)) { exit(1); }
+    store_close(&store);
+
+    // '.' and '0' are the same puzzle, and the entry survives reopening
+    char dotted[81];
+    for (int idx = 0; idx < 81; ++idx) {
+        dotted[idx] = (PROBLEM[idx] == '0') ? '.' : PROBLEM[idx];
+    }
+
+    char solution[81];
+    int is_solved = 0;
+    uint32_t nodes = 0;
+    if (store_open(&store, path, 100) != 0) { exit(1); }
+    if (!store_lookup(&store, dotted, 0, solution, &is_solved, &nodes)) { exit(1); }
+    if (!is_solved || nodes != 42 || memcmp(solution, SOLUTION, 81) != 0) {
+        printf("is_solved: %d nodes: %u solution: %.81s\n", is_solved, nodes, solution);
+        exit(1);
+    }
+
+    // Other variants of the same puzzle are separate entries
+    if (store_lookup(&store, PROBLEM, 1, solution, &is_solved, &nodes)) { exit(1); }
+    if (!store_insert(&store, PROBLEM, 1, NULL, 7)) { exit(1); }
+    if (!store_lookup(&store, PROBLEM, 1, solution, &is_solved, &nodes) || is_solved || nodes != 7) {
+        printf("is_solved: %d nodes: %u\n", is_solved, nodes);
+        exit(1);
+    }
+    store_close(&store);
+    unlink(path);
+}
+
+void test_cap_and_compact() {
+    char path[256];
+    make_path(path, sizeof(path));
+
+    Store store;
+    if (store_open(&store, path, 10) != 0) { exit(1); }
+    int inserted = 0;
+    for (int idx = 0; idx < 20; ++idx) {
+        char problem[81];
+        memcpy(problem, PROBLEM, 81);
+        problem[idx] = '0' + (idx % 10); // Unsolvable ones are stored too
+        inserted += store_insert(&store, problem, 0, NULL, idx);
+    }
+    store_close(&store);
+    if (inserted != 10) {
+        printf("inserted: %d\n", inserted);
+        exit(1);
+    }
+
+    if (store_compact(path, 4) != 4) { exit(1); }
+    if (store_open(&store, path, 0) != 0) { exit(1); }
+    if (store.header->count != 4 || store.header->max_count != 4) {
+        printf("count: %lu max_count: %lu\n", store.header->count, store.header->max_count);
+        exit(1);
+    }
+    store_close(&store);
+    unlink(path);
+}
+
+// An entry last used 65536 opens before compaction must still rank as the
+// oldest, which 16 bit generations got wrong.
+void test_compact_after_many_opens() {
+    char path[256];
+    make_path(path, sizeof(path));
+
+    char newer[81];
+    memcpy(newer, PROBLEM, 81);
+    newer[0] = '8';
+
+    Store store;
+    if (store_open(&store, path, 10) != 0) { exit(1); }
+    if (!store_insert(&store, PROBLEM, 0, SOLUTION, 1)) { exit(1); }
+    store.header->generation += 65536 - 2; // Skip the opens in between
+    store_close(&store);
+
+    if (store_open(&store, path, 10) != 0) { exit(1); }
+    if (!store_insert(&store, newer, 0, NULL, 2)) { exit(1); }
+    store_close(&store);
+
+    if (store_compact(path, 1) != 1) { exit(1); }
+
+    char solution[81];
+    int is_solved = 0;
+    uint32_t nodes = 0;
+    if (store_open(&store, path, 0) != 0) { exit(1); }
+    int has_newer = store_lookup(&store, newer, 0, solution, &is_solved, &nodes);
+    int has_older = store_lookup(&store, PROBLEM, 0, solution, &is_solved, &nodes);
+    if (!has_newer || has_older) {
+        printf("has_newer: %d has_older: %d\n", has_newer, has_older);
+        exit(1);
+    }
+    store_close(&store);
+    unlink(path);
+}
+
+int main() {
+    test_insert_lookup();
+    test_cap_and_compact();
+    test_compact_after_many_opens();
+}
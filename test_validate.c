@@ -0,0 +1,103 @@
+#include <stdio.h> // printf
+#include <stdlib.h> // exit, rand
+#include <string.h> // memcpy
+
+#include "simd.h"
+#include "validate.h"
+
+const char* PROBLEM = "004300209005009001070060043006002087190007400050083000600000105003508690042910300";
+const char* SOLUTION = "864371259325849761971265843436192587198657432257483916689734125713528694542916378";
+
+// Scalar reference: a house fails unless it holds each of '1'..'9' once
+uint32_t validate_scalar(const char* grid) {
+    uint32_t failed = 0;
+    for (int house = 0; house < 9; ++house) {
+        uint16_t seen[3] = {0, 0, 0};
+        for (int inner = 0; inner < 9; ++inner) {
+            int cells[3] = {
+                house * 9 + inner,
+                inner * 9 + house,
+                (house / 3) * 27 + (house % 3) * 3 + (inner / 3) * 9 + inner % 3,
+            };
+            for (int kind = 0; kind < 3; ++kind) {
+                char c = grid[cells[kind]];
+                seen[kind] |= (c >= '1' && c <= '9') ? 1u << (c - '1') : 0;
+            }
+        }
+        for (int kind = 0; kind < 3; ++kind) {
+            failed |= (seen[kind] != 0x1FF) ? 1u << (kind * 9 + house) : 0;
+        }
+    }
+    return failed;
+}
+
+void expect(const char* grid, const char* puzzle, uint32_t expected) {
+    uint32_t failed = validate_grid(grid, puzzle);
+    if (failed != expected) {
+        printf("grid: %.81s failed: %.08X expected: %.08X\n", grid, failed, expected);
+        exit(1);
+    }
+}
+
+void test_valid() {
+    expect(SOLUTION, NULL, 0);
+    expect(SOLUTION, PROBLEM, 0);
+}
+
+void test_single_cell() {
+    char grid[81];
+    memcpy(grid, SOLUTION, 81);
+    grid[40] = grid[41]; // Row 5, column 5, box 5
+
+    expect(grid, NULL, (1u << 4) | (1u << (9 + 4)) | (1u << (18 + 4)));
+}
+
+void test_givens() {
+    char grid[81];
+    char puzzle[81];
+    memcpy(grid, SOLUTION, 81);
+    memcpy(puzzle, PROBLEM, 81);
+    puzzle[0] = '1'; // Solution has 8 there
+
+    expect(grid, puzzle, VALIDATE_GIVENS_BIT);
+}
+
+void test_against_scalar() {
+    srand(1);
+    for (int iteration = 0; iteration < 10000; ++iteration) {
+        char grid[81];
+        memcpy(grid, SOLUTION, 81);
+        int changes = rand() % 4;
+        for (int change = 0; change < changes; ++change) {
+            grid[rand() % 81] = "0123456789.x"[rand() % 12];
+        }
+        expect(grid, NULL, validate_scalar(grid));
+    }
+}
+
+void test_batch() {
+    char grids[5 * 82];
+    uint32_t results[5];
+    for (int idx = 0; idx < 5; ++idx) {
+        memcpy(grids + idx * 82, SOLUTION, 81);
+        grids[idx * 82 + 81] = '\n';
+    }
+    grids[2 * 82 + 7] = '.';
+
+    validate_grids(grids, NULL, 82, 5, results);
+    for (int idx = 0; idx < 5; ++idx) {
+        if (results[idx] != validate_grid(grids + idx * 82, NULL)) {
+            printf("idx: %d batch: %.08X single: %.08X\n", idx, results[idx],
+                   validate_grid(grids + idx * 82, NULL));
+            exit(1);
+        }
+    }
+}
+
+int main() {
+    test_valid();
+    test_single_cell();
+    test_givens();
+    test_against_scalar();
+    test_batch();
+}
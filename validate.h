@@ -0,0 +1,182 @@
+#include <stddef.h> // size_t
+#include <stdint.h> // uint16_t, uint32_t, uint64_t
+#include <stdio.h> // snprintf
+
+#include <x86intrin.h> // AVX2, pext
+
+// Checks completed grids without solving them. Expects "simd.h" to be
+// included first for `movemask_epi16`.
+//
+// The 81 characters are one-hot encoded into 16 bit lanes (digit `d` becomes
+// `1 << (d - 1)`, anything else 0) and every house is OR-reduced with
+// unaligned loads of that array shifted by the offsets of its cells. A house
+// is valid when the reduction is the full mask 0x1FF, since 9 one-hot cells
+// can only cover 9 bits when they are all different.
+
+// Bits of the result of `validate_grid`. Zero means the grid is valid.
+#define VALIDATE_ROW_SHIFT 0
+#define VALIDATE_COLUMN_SHIFT 9
+#define VALIDATE_BOX_SHIFT 18
+#define VALIDATE_GIVENS_BIT (1u << 27) // Grid overwrites a given of the puzzle
+
+// Cells 0..80 plus room for the widest shifted load
+#define VALIDATE_CELLS 96
+
+// Bit `i` of the row / box masks set for the first cell of each house
+const uint64_t VALIDATE_ROW_STARTS = 0x8040201008040201ul; // 0, 9, .., 63
+const uint64_t VALIDATE_BOX_STARTS = 0x1240000248000049ul; // 0, 3, 6, 27, .., 60
+
+// Lane `i` is 1 << i for the 8 digits that fit into the low byte
+const char VALIDATE_LOW_BYTE[16] = {
+    1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0
+};
+const char VALIDATE_HIGH_BYTE[16] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0
+};
+
+// One-hot encodes 32 characters and stores them as 16 bit lanes at `output`.
+void one_hot_m256(const char* input, uint16_t* output) {
+    __m256i low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) VALIDATE_LOW_BYTE));
+    __m256i high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) VALIDATE_HIGH_BYTE));
+
+    __m256i digits = _mm256_sub_epi8(
+        _mm256_loadu_si256((const __m256i*) input), _mm256_set1_epi8('1')
+    );
+    // 0..8 for '1'..'9', everything else is masked out
+    __m256i is_digit = _mm256_and_si256(
+        _mm256_cmpgt_epi8(digits, _mm256_set1_epi8(-1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(9), digits)
+    );
+    digits = _mm256_or_si256(digits, _mm256_andnot_si256(is_digit, _mm256_set1_epi8(-128)));
+
+    __m256i low = _mm256_shuffle_epi8(low_table, digits);
+    __m256i high = _mm256_shuffle_epi8(high_table, digits);
+
+    // unpack works per 128 bit lane: [0..7, 16..23] and [8..15, 24..31]
+    __m256i first = _mm256_unpacklo_epi8(low, high);
+    __m256i second = _mm256_unpackhi_epi8(low, high);
+    _mm256_storeu_si256((__m256i*) output, _mm256_permute2x128_si256(first, second, 0x20));
+    _mm256_storeu_si256((__m256i*) (output + 16), _mm256_permute2x128_si256(first, second, 0x31));
+}
+
+// Bit `i` is set if the OR of cells i + offsets[0..8] is the full mask, for
+// the 16 cells starting at `start`.
+uint32_t full_houses_m256(const uint16_t* cells, int start, const int* offsets) {
+    __m256i accum = _mm256_setzero_si256();
+    #pragma GCC unroll 9
+    for (int idx = 0; idx < 9; ++idx) {
+        accum = _mm256_or_si256(
+            accum, _mm256_loadu_si256((const __m256i*) (cells + start + offsets[idx]))
+        );
+    }
+    return movemask_epi16(_mm256_cmpeq_epi16(accum, _mm256_set1_epi16(0x1FF)));
+}
+
+uint32_t validate_givens(const char* grid, const char* puzzle) {
+    // Bytes 49..80 overlap the second load so nothing past 81 is read
+    const int starts[3] = {0, 32, 49};
+    uint32_t mismatch = 0;
+    for (int idx = 0; idx < 3; ++idx) {
+        __m256i given = _mm256_loadu_si256((const __m256i*) (puzzle + starts[idx]));
+        __m256i cell = _mm256_loadu_si256((const __m256i*) (grid + starts[idx]));
+        __m256i digit = _mm256_sub_epi8(given, _mm256_set1_epi8('1'));
+        __m256i is_given = _mm256_and_si256(
+            _mm256_cmpgt_epi8(digit, _mm256_set1_epi8(-1)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8(9), digit)
+        );
+        mismatch |= _mm256_movemask_epi8(
+            _mm256_andnot_si256(_mm256_cmpeq_epi8(given, cell), is_given)
+        );
+    }
+    return mismatch ? VALIDATE_GIVENS_BIT : 0;
+}
+
+void one_hot_grid(const char* grid, uint16_t* cells) {
+    _mm256_store_si256((__m256i*) (cells + 80), _mm256_setzero_si256());
+    one_hot_m256(grid, cells);
+    one_hot_m256(grid + 32, cells + 32);
+    one_hot_m256(grid + 49, cells + 49);
+}
+
+// Failed house bits for one-hot encoded `cells`.
+uint32_t failed_houses(const uint16_t* cells) {
+    const int row_offsets[9] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+    const int column_offsets[9] = {0, 9, 18, 27, 36, 45, 54, 63, 72};
+    const int box_offsets[9] = {0, 1, 2, 9, 10, 11, 18, 19, 20};
+
+    uint64_t rows = (uint64_t) full_houses_m256(cells, 0, row_offsets)
+                  | (uint64_t) full_houses_m256(cells, 16, row_offsets) << 16
+                  | (uint64_t) full_houses_m256(cells, 32, row_offsets) << 32
+                  | (uint64_t) full_houses_m256(cells, 48, row_offsets) << 48;
+    uint32_t full_rows = _pext_u64(rows, VALIDATE_ROW_STARTS)
+                       | ((full_houses_m256(cells, 64, row_offsets) >> 8) & 1) << 8;
+
+    uint32_t full_columns = full_houses_m256(cells, 0, column_offsets) & 0x1FF;
+
+    uint64_t boxes = (uint64_t) full_houses_m256(cells, 0, box_offsets)
+                   | (uint64_t) full_houses_m256(cells, 16, box_offsets) << 16
+                   | (uint64_t) full_houses_m256(cells, 32, box_offsets) << 32
+                   | (uint64_t) full_houses_m256(cells, 48, box_offsets) << 48;
+    uint32_t full_boxes = _pext_u64(boxes, VALIDATE_BOX_STARTS);
+
+    return ((~full_rows & 0x1FF) << VALIDATE_ROW_SHIFT)
+         | ((~full_columns & 0x1FF) << VALIDATE_COLUMN_SHIFT)
+         | ((~full_boxes & 0x1FF) << VALIDATE_BOX_SHIFT);
+}
+
+// Returns 0 if the 81 characters of `grid` are a valid solution (and keep
+// every given of `puzzle` if it is not NULL), otherwise the bits of the failed
+// rows, columns and boxes plus VALIDATE_GIVENS_BIT. Reads exactly 81 bytes of
+// each input.
+uint32_t validate_grid(const char* grid, const char* puzzle) {
+    _Alignas(32) uint16_t cells[VALIDATE_CELLS];
+    one_hot_grid(grid, cells);
+
+    uint32_t failed = failed_houses(cells);
+    if (puzzle != NULL) {
+        failed |= validate_givens(grid, puzzle);
+    }
+    return failed;
+}
+
+// `validate_grid` for `count` grids laid out `stride` bytes apart (and their
+// puzzles, if `puzzles` is not NULL). The houses are reduced from unaligned
+// loads that straddle the stores of the encoding, which cannot be forwarded,
+// so the next grid is encoded into a second buffer before the current one is
+// reduced to give those stores time to retire.
+void validate_grids(const char* grids, const char* puzzles, int64_t stride, int64_t count,
+                    uint32_t* results) {
+    _Alignas(32) uint16_t cells[2][VALIDATE_CELLS];
+    if (count <= 0) { return; }
+
+    one_hot_grid(grids, cells[0]);
+    for (int64_t idx = 0; idx < count; ++idx) {
+        if (idx + 1 < count) {
+            one_hot_grid(grids + (idx + 1) * stride, cells[(idx + 1) & 1]);
+        }
+
+        uint32_t failed = failed_houses(cells[idx & 1]);
+        if (puzzles != NULL) {
+            failed |= validate_givens(grids + idx * stride, puzzles + idx * stride);
+        }
+        results[idx] = failed;
+    }
+}
+
+// Human readable list of the houses in `failed`, e.g. "row 1, box 1".
+// Truncated to fit `size`.
+void describe_validation(uint32_t failed, char* output, size_t size) {
+    const char* kinds[3] = {"row", "column", "box"};
+    size_t used = 0;
+    output[0] = '\0';
+
+    for (int bit = 0; (bit < 27) && (used < size); ++bit) {
+        if ((failed >> bit) & 1) {
+            used += snprintf(output + used, size - used, "%s%s %d",
+                             used ? ", " : "", kinds[bit / 9], bit % 9 + 1);
+        }
+    }
+    if ((failed & VALIDATE_GIVENS_BIT) && (used < size)) {
+        snprintf(output + used, size - used, "%sgivens changed", used ? ", " : "");
+    }
+}